@@ -0,0 +1,440 @@
+// Microbenchmarks of the hot paths: waveform processing (TSignal and
+// TBeamSignal), histogram fill and one analysis tick of TAsymmetry.
+// The waveforms are made by TWaveEmulator (synthetic), and taken from a
+// recorded file when it is found.  Each benchmark is run some times, and
+// the minimum and the median are reported.  The results are written in
+// JSON to compare the commits.  See README.md.
+
+#include <algorithm>
+#include <chrono>
+#include <ctime>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <Math/MinimizerOptions.h>
+#include <TFile.h>
+#include <TH2.h>
+#include <TROOT.h>
+#include <TTree.h>
+
+#include "TAsymmetry.hpp"
+#include "TBeamSignal.hpp"
+#include "TEventProcessor.hpp"
+#include "TFastHist2D.hpp"
+#include "TSignal.hpp"
+#include "TWaveBlock.hpp"
+#include "TWaveEmulator.hpp"
+
+namespace
+{
+constexpr uint32_t kRecordLength = 256;
+constexpr TWaveBlock::Channel_t kPlanes[3]{TWaveBlock::kIn, TWaveBlock::kOut1,
+                                           TWaveBlock::kOut2};
+
+// Results are summed here.  The compiler can not remove the work
+volatile double gSink = 0.;
+
+struct BenchResult_t {
+  std::string name;
+  std::string data;
+  std::string unit;
+  uint64_t nUnits;
+  double minNs;  // per unit
+  double medianNs;
+};
+
+// prepare() is not timed.  run() processes nUnits units
+template <typename P, typename R>
+BenchResult_t Measure(const std::string &name, const std::string &data,
+                      const std::string &unit, uint64_t nUnits, int repeat,
+                      P prepare, R run)
+{
+  std::vector<double> times;
+  // One more for the warm up (caches and page faults)
+  for (auto i = 0; i <= repeat; i++) {
+    prepare();
+    const auto start = std::chrono::steady_clock::now();
+    run();
+    const std::chrono::duration<double, std::nano> elapsed =
+        std::chrono::steady_clock::now() - start;
+    if (i > 0) times.push_back(elapsed.count() / nUnits);
+  }
+  std::sort(times.begin(), times.end());
+
+  BenchResult_t result;
+  result.name = name;
+  result.data = data;
+  result.unit = unit;
+  result.nUnits = nUnits;
+  result.minNs = times.front();
+  result.medianNs = times[times.size() / 2];
+  return result;
+}
+
+template <typename R>
+BenchResult_t Measure(const std::string &name, const std::string &data,
+                      const std::string &unit, uint64_t nUnits, int repeat,
+                      R run)
+{
+  return Measure(name, data, unit, nUnits, repeat, [] {}, run);
+}
+
+void CopyEvent(const TWaveBlock &src, uint32_t iEve, TWaveBlock &dest)
+{
+  const auto index = dest.AddEvent(src.GetTime(iEve));
+  for (auto ch = 0; ch < TWaveBlock::kNChs; ch++) {
+    auto channel = TWaveBlock::Channel_t(ch);
+    std::copy_n(src.GetTrace(channel, iEve), dest.GetRecordLength(),
+                dest.GetTrace(channel, index));
+  }
+}
+
+void MakeSynthetic(TWaveBlock &block, uint32_t nEvents)
+{
+  TWaveEmulator emulator;
+  emulator.SetSeed(1);  // Same waveforms for all commits
+  emulator.Initialize();
+  emulator.StartAcquisition();
+
+  const auto &src = emulator.GetWaveBlock();
+  block.Allocate(nEvents, src.GetRecordLength());
+  while (!block.IsFull()) {
+    emulator.ReadEvents();
+    for (uint32_t i = 0; i < src.GetNEvents() && !block.IsFull(); i++)
+      CopyEvent(src, i, block);
+  }
+}
+
+// Same branches as TPolarimeter::FetchDummyData().  Out1 and Out2 have the
+// same trace.  The file is read again from the top when it is short
+bool LoadRecorded(const std::string &fileName, TWaveBlock &block,
+                  uint32_t nEvents)
+{
+  std::unique_ptr<TFile> file(TFile::Open(fileName.c_str(), "READ"));
+  if (!file || file->IsZombie()) return false;
+  auto tree = (TTree *)file->Get("wave");
+  if (!tree || tree->GetEntries() == 0) return false;
+  tree->SetBranchStatus("*", kFALSE);
+
+  std::vector<short> *trace[3]{nullptr};
+  const char *branches[3]{"trace0", "trace1", "trace8"};
+  for (auto i = 0; i < 3; i++) {
+    tree->SetBranchStatus(branches[i], kTRUE);
+    tree->SetBranchAddress(branches[i], &trace[i]);
+  }
+
+  // Short traces are filled by the last sample (baseline)
+  auto copyTrace = [](const std::vector<short> *trace, short *dest) {
+    auto size = std::min<std::size_t>(trace->size(), kRecordLength);
+    std::copy(trace->begin(), trace->begin() + size, dest);
+    if (size > 0) std::fill(dest + size, dest + kRecordLength, dest[size - 1]);
+  };
+
+  block.Allocate(nEvents, kRecordLength);
+  const auto nEntries = tree->GetEntries();
+  for (auto iEve = 0; !block.IsFull(); iEve++) {
+    if (iEve >= nEntries) iEve = 0;
+    tree->GetEntry(iEve);
+    for (auto i = 0; i < 3; i++) {
+      if (!trace[i] || trace[i]->empty()) return false;
+    }
+
+    const auto index = block.AddEvent(0);
+    copyTrace(trace[0], block.GetTrace(TWaveBlock::kIn, index));
+    copyTrace(trace[1], block.GetTrace(TWaveBlock::kOut1, index));
+    copyTrace(trace[1], block.GetTrace(TWaveBlock::kOut2, index));
+    copyTrace(trace[2], block.GetTrace(TWaveBlock::kBeam, index));
+  }
+
+  file->Close();
+  return true;
+}
+
+// Same parameters as TEventProcessor
+void SetSignalParameters(TSignal &signal)
+{
+  signal.SetThreshold(500.);
+  signal.SetCFDThreshold(0.);
+  signal.SetShortGate(30);
+  signal.SetLongGate(300);
+}
+
+void BenchSignal(const TWaveBlock &block, const std::string &data, int repeat,
+                 std::vector<BenchResult_t> &results)
+{
+  const auto nEvents = block.GetNEvents();
+  const auto length = block.GetRecordLength();
+  const uint64_t nWaveforms = 3 * nEvents;
+
+  TSignal signal;
+  SetSignalParameters(signal);
+
+  results.push_back(Measure("TSignal::ProcessSignal", data, "waveform",
+                            nWaveforms, repeat, [&] {
+                              auto sum = 0.;
+                              for (auto ch : kPlanes) {
+                                for (uint32_t i = 0; i < nEvents; i++) {
+                                  signal.SetSignal(block.GetTrace(ch, i),
+                                                   length);
+                                  signal.ProcessSignal();
+                                  sum += signal.GetLongCharge();
+                                }
+                              }
+                              gSink = gSink + sum;
+                            }));
+
+  results.push_back(Measure("TSignal::ProcessSignalScalar", data, "waveform",
+                            nWaveforms, repeat, [&] {
+                              auto sum = 0.;
+                              for (auto ch : kPlanes) {
+                                for (uint32_t i = 0; i < nEvents; i++) {
+                                  signal.SetSignal(block.GetTrace(ch, i),
+                                                   length);
+                                  signal.ProcessSignalScalar();
+                                  sum += signal.GetLongCharge();
+                                }
+                              }
+                              gSink = gSink + sum;
+                            }));
+
+  SignalBatch_t batch;
+  batch.Resize(nEvents);
+  results.push_back(Measure("TSignal::ProcessBatch", data, "waveform",
+                            nWaveforms, repeat, [&] {
+                              for (auto ch : kPlanes) {
+                                signal.ProcessBatch(block.GetChannel(ch),
+                                                    nEvents, length, batch);
+                              }
+                              gSink = gSink + batch.longCharge[0];
+                            }));
+
+  TBeamSignal beam;
+  results.push_back(Measure("TBeamSignal::ProcessSignal", data, "waveform",
+                            nEvents, repeat, [&] {
+                              auto sum = 0.;
+                              for (uint32_t i = 0; i < nEvents; i++) {
+                                beam.SetSignal(
+                                    block.GetTrace(TWaveBlock::kBeam, i),
+                                    length);
+                                beam.ProcessSignal();
+                                sum += beam.GetTrgTime();
+                              }
+                              gSink = gSink + sum;
+                            }));
+
+  // ProcessSignalScalar() of TBeamSignal is CalTrgTime() only
+  results.push_back(Measure("TBeamSignal::CalTrgTime", data, "waveform",
+                            nEvents, repeat, [&] {
+                              auto sum = 0.;
+                              for (uint32_t i = 0; i < nEvents; i++) {
+                                beam.SetSignal(
+                                    block.GetTrace(TWaveBlock::kBeam, i),
+                                    length);
+                                beam.ProcessSignalScalar();
+                                sum += beam.GetTrgTime();
+                              }
+                              gSink = gSink + sum;
+                            }));
+
+  std::vector<double> beamTrg(nEvents);
+  results.push_back(
+      Measure("TBeamSignal::ProcessBatch", data, "waveform", nEvents, repeat,
+              [&] {
+                beam.ProcessBatch(block.GetChannel(TWaveBlock::kBeam),
+                                  nEvents, length, beamTrg);
+                gSink = gSink + beamTrg[0];
+              }));
+}
+
+// TOF and PS of the 3 planes which TEventProcessor::ProcessBlock() fills.
+// TOF is given by TEventProcessor::CalTOF(), the one of ProcessBlock()
+void MakePoints(const TWaveBlock &block, std::vector<double> tof[3],
+                std::vector<double> ps[3])
+{
+  const auto nEvents = block.GetNEvents();
+  const auto length = block.GetRecordLength();
+
+  TSignal signal;
+  SetSignalParameters(signal);
+  TBeamSignal beam;
+
+  std::vector<double> beamTrg(nEvents);
+  beam.ProcessBatch(block.GetChannel(TWaveBlock::kBeam), nEvents, length,
+                    beamTrg);
+  SignalBatch_t batch;
+  batch.Resize(nEvents);
+  for (auto i = 0; i < 3; i++) {
+    signal.ProcessBatch(block.GetChannel(kPlanes[i]), nEvents, length, batch);
+    tof[i].clear();
+    ps[i].clear();
+    for (uint32_t iEve = 0; iEve < nEvents; iEve++) {
+      const auto t = TEventProcessor::CalTOF(i, batch.trgTime[iEve],
+                                             beamTrg[iEve]);
+      if (!(t > 0.)) continue;  // Not filled by ProcessBlock()
+      tof[i].push_back(t);
+      ps[i].push_back(batch.shortCharge[iEve] / batch.longCharge[iEve]);
+    }
+  }
+}
+
+void BenchAnalysis(const TWaveBlock &block, const std::string &data,
+                   int repeat, std::vector<BenchResult_t> &results)
+{
+  std::vector<double> tof[3];
+  std::vector<double> ps[3];
+  MakePoints(block, tof, ps);
+  const uint64_t nPoints = tof[0].size() + tof[1].size() + tof[2].size();
+  if (nPoints == 0) {
+    std::cout << data << ": No event in the histograms.  Skipped"
+              << std::endl;
+    return;
+  }
+
+  // Same binning as TPolarimeter
+  std::unique_ptr<TH2D> hist(
+      new TH2D("BenchHist", "PS vs TOF", 1000, 0., 100., 1000, 0., 1.));
+  hist->SetDirectory(nullptr);
+  results.push_back(Measure(
+      "TH2D::Fill", data, "fill", nPoints, repeat, [&] { hist->Reset(); },
+      [&] {
+        for (auto i = 0; i < 3; i++) {
+          for (std::size_t j = 0; j < tof[i].size(); j++)
+            hist->Fill(tof[i][j], ps[i][j]);
+        }
+      }));
+
+  TFastHist2D fastHist(hist.get());
+  results.push_back(Measure(
+      "TFastHist2D::Fill", data, "fill", nPoints, repeat,
+      [&] { fastHist.Reset(); },
+      [&] {
+        for (auto i = 0; i < 3; i++) {
+          for (std::size_t j = 0; j < tof[i].size(); j++)
+            fastHist.Fill(tof[i][j], ps[i][j]);
+        }
+      }));
+
+  // One plane of the analysis tick of TPolarimeter::DeriveYields()
+  hist->Reset();
+  for (std::size_t j = 0; j < tof[0].size(); j++)
+    hist->Fill(tof[0][j], ps[0][j]);
+  for (auto fastMode : {false, true}) {
+    TAsymmetry plane(hist.get());
+    plane.SetFastMode(fastMode);
+    const auto name =
+        std::string("TAsymmetry::DataAnalysis") + (fastMode ? "(fast)" : "");
+    results.push_back(Measure(name, data, "tick", 1, repeat, [&] {
+      plane.DataAnalysis();
+      gSink = gSink + plane.GetYield();
+    }));
+  }
+}
+
+void Print(const std::vector<BenchResult_t> &results)
+{
+  std::cout << "\nBenchmark\tData\tMin [ns]\tMedian [ns]\tUnit" << std::endl;
+  for (auto &&result : results) {
+    std::cout << result.name << "\t" << result.data << "\t" << result.minNs
+              << "\t" << result.medianNs << "\t" << result.unit << std::endl;
+  }
+}
+
+// Names have no character to be escaped
+bool WriteJSON(const std::string &fileName, const std::string &tag,
+               uint32_t nEvents, int repeat,
+               const std::vector<BenchResult_t> &results)
+{
+  std::ofstream file(fileName);
+  if (!file) return false;
+
+  char timeStr[32];
+  auto now = time(nullptr);
+  strftime(timeStr, sizeof(timeStr), "%Y-%m-%dT%H:%M:%S", localtime(&now));
+
+  file.precision(6);
+  file << "{\n"
+       << "  \"tag\": \"" << tag << "\",\n"
+       << "  \"time\": \"" << timeStr << "\",\n"
+       << "  \"events\": " << nEvents << ",\n"
+       << "  \"repeat\": " << repeat << ",\n"
+       << "  \"results\": [\n";
+  for (std::size_t i = 0; i < results.size(); i++) {
+    auto &&result = results[i];
+    file << "    {\"name\": \"" << result.name << "\", \"data\": \""
+         << result.data << "\", \"unit\": \"" << result.unit
+         << "\", \"n\": " << result.nUnits << ", \"min_ns\": " << result.minNs
+         << ", \"median_ns\": " << result.medianNs << "}"
+         << (i + 1 < results.size() ? "," : "") << "\n";
+  }
+  file << "  ]\n"
+       << "}" << std::endl;
+
+  return bool(file);
+}
+}  // namespace
+
+int main(int argc, char **argv)
+{
+  uint32_t nEvents = 100000;
+  auto repeat = 5;
+  std::string dataFile = "Data/wave11.root";
+  std::string outputFile = "polarimeter_bench.json";
+  std::string tag = "";
+  for (auto i = 1; i < argc; i++) {
+    if (std::string(argv[i]) == "-h") {
+      std::cout << "polarimeter_bench [--events N] [--repeat N] [--data FILE] "
+                   "[--output FILE] [--tag TEXT]\n"
+                << "--events N: Events of each data set (default: 100000)\n"
+                << "--repeat N: Runs of each benchmark (default: 5)\n"
+                << "--data FILE: Recorded waveforms (default: "
+                   "Data/wave11.root).  Skipped if not found\n"
+                << "--output FILE: JSON results (default: "
+                   "polarimeter_bench.json)\n"
+                << "--tag TEXT: Written in the results, e.g. the commit"
+                << std::endl;
+      return 1;
+    } else if (std::string(argv[i]) == "--events" && i + 1 < argc) {
+      nEvents = std::stoul(argv[++i]);
+    } else if (std::string(argv[i]) == "--repeat" && i + 1 < argc) {
+      repeat = std::stoi(argv[++i]);
+    } else if (std::string(argv[i]) == "--data" && i + 1 < argc) {
+      dataFile = argv[++i];
+    } else if (std::string(argv[i]) == "--output" && i + 1 < argc) {
+      outputFile = argv[++i];
+    } else if (std::string(argv[i]) == "--tag" && i + 1 < argc) {
+      tag = argv[++i];
+    }
+  }
+  if (nEvents == 0) nEvents = 1;
+  if (repeat < 1) repeat = 1;
+
+  // Same as polarimeter
+  gROOT->SetBatch(kTRUE);
+  ROOT::Math::MinimizerOptions::SetDefaultMinimizer("Minuit2");
+
+  std::vector<BenchResult_t> results;
+
+  TWaveBlock block;
+  MakeSynthetic(block, nEvents);
+  BenchSignal(block, "synthetic", repeat, results);
+  BenchAnalysis(block, "synthetic", repeat, results);
+
+  if (LoadRecorded(dataFile, block, nEvents)) {
+    BenchSignal(block, "recorded", repeat, results);
+    BenchAnalysis(block, "recorded", repeat, results);
+  } else {
+    std::cout << dataFile << " can not be read.  Only synthetic waveforms"
+              << std::endl;
+  }
+
+  Print(results);
+  if (!WriteJSON(outputFile, tag, nEvents, repeat, results)) {
+    std::cout << outputFile << " can not be written" << std::endl;
+    return 1;
+  }
+
+  return 0;
+}
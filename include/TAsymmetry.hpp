@@ -11,6 +11,19 @@
 #include <TSpectrum.h>
 #include <TString.h>
 
+#include "TFastHist2D.hpp"
+#include "THistRing.hpp"
+
+// Area of the yield, [tofMin, tofMax) x [psMin, psMax).  Same bins as
+// TAsymmetry::Integral().  Given to TEventProcessor for the streaming yield
+struct YieldCut_t {
+  bool valid;
+  double tofMin;
+  double tofMax;
+  double psMin;
+  double psMax;
+};
+
 class TAsymmetry
 {
  public:
@@ -19,6 +32,10 @@ class TAsymmetry
   ~TAsymmetry();
 
   void SetHist(const TH2 *hist);
+  // Adding the new events.  The projections are updated only for the filled
+  // bins of hist.  The cut projections are made again only when the cut
+  // positions are moved by DataAnalysis().  hist has the same binning.
+  void AddHist(const TFastHist2D &hist);
 
   void Plot();
   void DrawResult();
@@ -26,7 +43,26 @@ class TAsymmetry
 
   void DataAnalysis();
 
+  // Fast mode: peak finding and gaussian estimation without TSpectrum and
+  // TF1.  The peaks are found on the smoothed projection, and mean and
+  // sigma are given by a weighted fit of log(count) with a parabola.
+  void SetFastMode(bool flag) { fFastMode = flag; };
+  // Running both ways on the current histograms, and printing the
+  // differences and the time.  Call after DataAnalysis() and GetYield()
+  void CheckFastMode();
+
   double GetYield() { return Integral(); };
+  // Yield of the last nSlices slices of ring (0 = all), with the cuts of
+  // the last GetYield().  ring should be filled with the same events
+  double GetYield(const THistRing &ring, uint32_t nSlices) const;
+  // Area used by the last GetYield().  Not valid before it
+  YieldCut_t GetYieldCut() const;
+  // Results of the last DataAnalysis() and GetYield()
+  double GetTimeTh() const { return fTimeTh; };
+  double GetPulseShapeTh() const { return fPulseShapeTh; };
+  double GetPSPeak() const { return fPSPeak; };
+  double GetPSSigma() const { return fPSSigma; };
+  double GetTOFPeak() const { return fTOFPeak; };
 
  private:
   int fIndex;
@@ -34,7 +70,11 @@ class TAsymmetry
   std::unique_ptr<TH2D> fHist;
   std::unique_ptr<TH1D> fHistTime;
   std::unique_ptr<TH1D> fHistPS;
+  // TOF of PS bins [1, fPSCutBin]
+  std::unique_ptr<TH1D> fHistPSCut;
+  // TOF of PS bins [fResultStartBin, fResultEndBin]
   std::unique_ptr<TH1D> fHistResult;
+  // PS of TOF bins [fSlowCutBin, overflow]
   std::unique_ptr<TH1D> fHistSlowComponent;
   std::unique_ptr<TCanvas> fCanvas;
   std::unique_ptr<TF1> fFitFnc;
@@ -47,7 +87,19 @@ class TAsymmetry
 
   void PulseShapeCut();
   void PulseShapeCutLast();
+  void FitSlowComponent(double &peak, double &sigma);
+  void FitSlowComponentFast(double &peak, double &sigma);
+  double FindTOFPeak();
+  double FindTOFPeakFast();
+  bool fFastMode;
+  double fPSPeak;
+  double fPSSigma;
+  double fTOFPeak;
   double fPulseShapeTh;
+  int fPSCutBin;
+  int fSlowCutBin;
+  int fResultStartBin;
+  int fResultEndBin;
   std::unique_ptr<TLine> fHorLine;
 
   void TimeCut();
@@ -56,6 +108,8 @@ class TAsymmetry
 
   double Integral();
   double fTimeWindow;
+  int fYieldStartBin;  // TOF bins used by the last Integral()
+  int fYieldStopBin;
   std::unique_ptr<TBox> fArea;
 };
 
@@ -10,12 +10,21 @@ class TBeamSignal : public TSignal
   TBeamSignal(std::vector<short> *signal);
   ~TBeamSignal();
 
-  virtual void SetSignal(std::vector<short> *signal) override;
+  using TSignal::SetSignal;
+  virtual void SetSignal(const short *signal, uint32_t size) override;
+
+  virtual void ProcessSignal() override;
+  virtual void ProcessSignalScalar() override { CalTrgTime(); };
+  // nWaveforms contiguous waveforms of recordLength
+  void ProcessBatch(const short *data, uint32_t nWaveforms,
+                    uint32_t recordLength, std::vector<double> &trgTime);
 
   virtual void Plot() override;
 
  private:
   void SetThreshold();
+  // Core of ProcessSignal() and ProcessBatch()
+  static double FindTrgTime(const short *signal, int size);
 
   virtual void CalBaseLine() override{};
 
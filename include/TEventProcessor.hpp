@@ -0,0 +1,125 @@
+#ifndef TEVENTPROCESSOR_HPP
+#define TEVENTPROCESSOR_HPP 1
+
+// One worker of the waveform processing.
+// It has its own queue of batches and its own PS vs TOF histograms
+// (TFastHist2D, same binning as the template TH2D).
+// The histograms are moved to the global ones only by MergeHists(),
+// which is called when TPolarimeter runs the analysis.
+// There are two sets of the histograms.  The worker fills the set of the
+// current epoch, and MergeHists() switches the epoch and takes the other
+// set.  Filling is never blocked by the analysis.
+
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include <TH2.h>
+
+#include "TAsymmetry.hpp"
+#include "TBeamSignal.hpp"
+#include "TFastHist2D.hpp"
+#include "TMetrics.hpp"
+#include "TRingBuffer.hpp"
+#include "TSignal.hpp"
+#include "TWaveBlock.hpp"
+
+class TEventProcessor
+{
+ public:
+  TEventProcessor(uint32_t id, uint32_t queueSize, const TWaveBlock &prototype,
+                  const TH2D *hisTemplate);
+  ~TEventProcessor();
+
+  // Can be called while running.  The worker takes them before the next
+  // batch, so one batch is processed by one set of the parameters
+  void SetSignalParameters(double th, double cfd, int shortGate, int longGate);
+
+  void Start();
+  void Stop();
+
+  // Single producer side.  nullptr means the queue is full
+  TWaveBlock *GetWriteSlot() { return fQueue->GetWriteSlot(); };
+  void Push() { fQueue->Push(); };
+
+  // Adding the histograms into the given ones, and reset own histograms
+  void MergeHists(TFastHist2D *hisIn, TFastHist2D *hisOut1,
+                  TFastHist2D *hisOut2);
+
+  // Streaming yield.  Events in the cut area are counted for each plane
+  // (in, out1, out2).  The counters are reset by SetYieldCuts()
+  void SetYieldCuts(const YieldCut_t &cutIn, const YieldCut_t &cutOut1,
+                    const YieldCut_t &cutOut2);
+  uint64_t GetStreamYield(int plane) const { return fStreamYield[plane]; };
+
+  uint64_t GetNProcessed() { return fProcessCounter.exchange(0); };
+  uint32_t GetOccupancy() const { return fQueue->GetOccupancy(); };
+  uint32_t GetCapacity() const { return fQueue->GetCapacity(); };
+  uint32_t GetHighWaterMark() const { return fQueue->GetHighWaterMark(); };
+  // Processing time of a batch / events in it
+  const TLatencyHist &GetEventLatency() const { return fEventLatency; };
+
+  // TOF of one event of plane (in, out1, out2).  0 is not filled and not
+  // counted.  Used for the events without the trigger of the plane or the
+  // beam
+  static double CalTOF(int plane, double trgTime, double beamTrg)
+  {
+    constexpr double timeOffset[3]{0., 10.14 + 1.04,
+                                   10.14 + 1.04};  // Check Aogaki
+    if (trgTime > 0. && beamTrg > 0.)
+      return trgTime - beamTrg + timeOffset[plane];
+    return 0.;
+  };
+
+ private:
+  uint32_t fID;
+  std::unique_ptr<TRingBuffer<TWaveBlock>> fQueue;
+
+  std::unique_ptr<TSignal> fInSignal;
+  std::unique_ptr<TSignal> fOutSignal1;
+  std::unique_ptr<TSignal> fOutSignal2;
+  std::unique_ptr<TBeamSignal> fBeam;
+
+  // Given by SetSignalParameters().  Same way as the cuts below
+  std::mutex fParMutex;
+  double fThreshold;
+  double fCFDThreshold;
+  int fShortGate;
+  int fLongGate;
+  std::atomic<uint32_t> fParVersion;
+  uint32_t fWorkerParVersion;
+  void ApplySignalParameters();
+
+  // [epoch & 1][in, out1, out2]
+  std::unique_ptr<TFastHist2D> fHists[2][3];
+  std::atomic<uint32_t> fEpoch;
+  // Epoch of the set being filled by the worker, or kIdleEpoch
+  std::atomic<uint32_t> fFillEpoch;
+
+  // Cuts given by SetYieldCuts(), and the copy of the worker.
+  // The worker copies them only when fCutVersion is changed.
+  std::mutex fCutMutex;
+  YieldCut_t fCuts[3];
+  std::atomic<uint32_t> fCutVersion;
+  YieldCut_t fWorkerCuts[3];
+  uint32_t fWorkerCutVersion;
+  std::atomic<uint64_t> fStreamYield[3];
+  void CountYields(uint32_t nEvents);
+
+  // Results of one batch.  Filled into histograms at once
+  SignalBatch_t fResult[3];
+  std::vector<double> fBeamTrg;
+  std::vector<double> fTOF[3];
+  std::vector<double> fPS[3];
+
+  void Loop();
+  void ProcessBlock(const TWaveBlock &block);
+  std::thread fThread;
+  std::atomic<bool> fRunning;
+  std::atomic<uint64_t> fProcessCounter;
+  TLatencyHist fEventLatency;
+};
+
+#endif
@@ -0,0 +1,83 @@
+#ifndef TFASTHIST2D_HPP
+#define TFASTHIST2D_HPP 1
+
+// Fixed binning 2D histogram of 32 bits counters for the fill hot path.
+// Bin layout and bin finding are same as TH2 (under and overflow bins
+// included).  Not thread safe, each worker fills its own one.
+// It is converted to TH2D by AddTo() only when the analysis needs it.
+// Filled bins are listed, then Add(), AddTo() and Reset() cost only the
+// number of filled bins, not the whole 1000 x 1000 bins.
+
+#include <cstdint>
+#include <vector>
+
+#include <TH2.h>
+
+class TFastHist2D
+{
+ public:
+  TFastHist2D(int nBinsX, double xMin, double xMax, int nBinsY, double yMin,
+              double yMax);
+  // Same binning as hist
+  explicit TFastHist2D(const TH2 *hist);
+  ~TFastHist2D() {}
+
+  void Fill(double x, double y)
+  {
+    const auto bin = FindBin(x, fXMin, fXMax, fXRange, fNBinsX) +
+                     fNCellsX * FindBin(y, fYMin, fYMax, fYRange, fNBinsY);
+    if (fCounts[bin]++ == 0) fFilledBins.push_back(bin);
+    fEntries++;
+  };
+
+  void Reset();
+  void Add(const TFastHist2D &hist);
+  // Adding the counts into hist.  hist should have the same binning
+  void AddTo(TH2 *hist) const;
+
+  uint32_t GetBinContent(int binX, int binY) const
+  {
+    return fCounts[binX + fNCellsX * binY];
+  };
+  // Global bin, same as TH2
+  uint32_t GetBinContent(int bin) const { return fCounts[bin]; };
+  void GetBinXY(int bin, int &binX, int &binY) const
+  {
+    binX = bin % fNCellsX;
+    binY = bin / fNCellsX;
+  };
+  // Global bins of non zero content, in the filled order
+  const std::vector<int> &GetFilledBins() const { return fFilledBins; };
+  uint64_t GetEntries() const { return fEntries; };
+  int GetNBinsX() const { return fNBinsX; };
+  int GetNBinsY() const { return fNBinsY; };
+
+ private:
+  int fNBinsX;
+  double fXMin;
+  double fXMax;
+  double fXRange;
+  int fNBinsY;
+  double fYMin;
+  double fYMax;
+  double fYRange;
+
+  int fNCellsX;  // fNBinsX + 2
+  std::vector<uint32_t> fCounts;
+  std::vector<int> fFilledBins;
+  uint64_t fEntries;
+
+  static int FindBin(double val, double min, double max, double range,
+                     int nBins)
+  {
+    // Same as TAxis::FindBin().  NaN goes to the overflow bin
+    if (val < min) return 0;
+    if (!(val < max)) return nBins + 1;
+    return 1 + int(nBins * (val - min) / range);
+  };
+
+  void SetBinning(int nBinsX, double xMin, double xMax, int nBinsY,
+                  double yMin, double yMax);
+};
+
+#endif
@@ -0,0 +1,104 @@
+#ifndef TFIXEDSIGNAL_HPP
+#define TFIXEDSIGNAL_HPP 1
+
+// TSignal::ProcessBatch() with the record length, rewind and gates known at
+// compile time.  Gate lengths and offsets are constants, and the clipping of
+// the gates is only done near the end of the record.  Results are same as
+// the dynamic path.
+// TSignal::ProcessBatch() selects one with TFixedSignalList::Find(), and
+// uses the dynamic path when the configuration is not instantiated.
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+
+#include "TSignal.hpp"
+#include "TSignalKernel.hpp"
+
+template <int RecordLength, int Rewind, int ShortGate, int LongGate>
+class TFixedSignal
+{
+ public:
+  static void ProcessBatch(const short *data, uint32_t nWaveforms,
+                           double threshold, double cfd,
+                           SignalBatch_t &result);
+};
+
+class TFixedSignalList
+{
+ public:
+  // nullptr when the configuration is not instantiated
+  static FixedBatchFunc_t Find(int recordLength, int rewind, int shortGate,
+                               int longGate);
+};
+
+template <int RecordLength, int Rewind, int ShortGate, int LongGate>
+void TFixedSignal<RecordLength, Rewind, ShortGate, LongGate>::ProcessBatch(
+    const short *data, uint32_t nWaveforms, double threshold, double cfd,
+    SignalBatch_t &result)
+{
+  static_assert(ShortGate <= LongGate, "Short gate is a part of long gate");
+  constexpr int nBase = (RecordLength < 40) ? RecordLength : 40;
+
+  if (result.trgTime.size() < nWaveforms) result.Resize(nWaveforms);
+
+  for (uint32_t iWave = 0; iWave < nWaveforms; iWave++) {
+    const short *signal = data + std::size_t(iWave) * RecordLength;
+    auto &trgTime = result.trgTime[iWave];
+    auto &shortCharge = result.shortCharge[iWave];
+    auto &longCharge = result.longCharge[iWave];
+    auto &pulseHeight = result.pulseHeight[iWave];
+
+    const int64_t baseSum = TSignalKernel::Sum(signal, 0, nBase);
+    const double baseLine = double(baseSum) / nBase;
+    const double min = TSignalKernel::Min(signal, RecordLength);
+
+    trgTime = 0.;
+    shortCharge = 0.;
+    longCharge = 0.;
+    pulseHeight = 0.;
+
+    if (threshold < baseLine - min) {
+      const auto th = baseLine - ((baseLine - min) * (cfd / 100.));
+      const auto i = TSignalKernel::FindCrossing(signal, RecordLength,
+                                                 std::ceil(th), std::floor(th));
+      // Both samples on th (dy = 0) is no trigger, not 0 / 0
+      if (i >= 0 && signal[i + 1] != signal[i]) {
+        auto dx = 1.;
+        auto dy = double(signal[i + 1] - signal[i]);
+        auto diff = double(th - signal[i]);
+        trgTime = i + diff * dx / dy;
+      }
+    }
+    // Same as the dynamic path.  NaN is not processed
+    if (!(trgTime > 0.)) continue;
+
+    auto start = int(trgTime) - Rewind;
+    if (start < 0) start = 0;
+
+    int64_t shortSum, longSum;
+    int64_t shortLength, longLength;
+    if (start + LongGate <= RecordLength) {
+      // Fixed length gates
+      shortSum = TSignalKernel::Sum(signal, start, start + ShortGate);
+      longSum = shortSum + TSignalKernel::Sum(signal, start + ShortGate,
+                                              start + LongGate);
+      shortLength = ShortGate;
+      longLength = LongGate;
+    } else {
+      // Gates are cut by the end of the record
+      const auto shortStop = std::min(start + ShortGate, RecordLength);
+      const auto longStop = std::min(start + LongGate, RecordLength);
+      shortSum = TSignalKernel::Sum(signal, start, shortStop);
+      longSum = shortSum + TSignalKernel::Sum(signal, shortStop, longStop);
+      shortLength = shortStop - start;
+      longLength = longStop - start;
+    }
+
+    shortCharge = double(shortLength * baseSum - nBase * shortSum) / nBase;
+    longCharge = double(longLength * baseSum - nBase * longSum) / nBase;
+    pulseHeight = baseLine - min;
+  }
+}
+
+#endif
@@ -0,0 +1,43 @@
+#ifndef THISTCODEC_HPP
+#define THISTCODEC_HPP 1
+
+// Sparse binary form of a 2D histogram for the result upload.
+// Only non zero bins are written, as pairs of (global bin step, count).
+// The global bin is same as TH2 (under and overflow bins included), and
+// the step is from the previous written bin (the first one from 0).
+// Both numbers are unsigned LEB128 varints.  Counts are rounded to integers.
+// The binning itself is not in the data.  See README.md for the schema.
+
+#include <cstdint>
+#include <vector>
+
+#include <TH2.h>
+
+#include "TFastHist2D.hpp"
+
+class THistCodec
+{
+ public:
+  // buf is cleared.  Returns the number of written bins
+  static uint32_t Encode(const TH2 *hist, std::vector<uint8_t> &buf);
+  // Only the filled bins are read.  For the delta since the last upload
+  static uint32_t Encode(const TFastHist2D &hist, std::vector<uint8_t> &buf);
+  // Adding the counts of data into hist.  hist should have the binning of
+  // the encoded one.  Returns false for broken data (bins before it are
+  // added)
+  static bool Decode(const uint8_t *data, std::size_t size, TH2 *hist);
+
+ private:
+  static void PutVarint(uint64_t val, std::vector<uint8_t> &buf)
+  {
+    while (val >= 0x80) {
+      buf.push_back(uint8_t(val) | 0x80);
+      val >>= 7;
+    }
+    buf.push_back(uint8_t(val));
+  };
+  static bool GetVarint(const uint8_t *&data, const uint8_t *end,
+                        uint64_t &val);
+};
+
+#endif
@@ -0,0 +1,54 @@
+#ifndef THISTRING_HPP
+#define THISTRING_HPP 1
+
+// Ring of time slices of PS vs TOF events.  One slice is the delta of one
+// analysis interval, kept as a sparse list of bins.  When the ring is
+// full, the oldest slice is overwritten.  Counts in a rectangle of bins
+// are summed over the last N slices without touching the full histogram.
+
+#include <cstdint>
+#include <vector>
+
+#include "TFastHist2D.hpp"
+
+class THistRing
+{
+ public:
+  THistRing(uint32_t depth);
+  ~THistRing() {}
+
+  // The filled bins of hist become the newest slice
+  void AddSlice(const TFastHist2D &hist);
+  void Clear();
+
+  // Sum of the bins [x1, x2] x [y1, y2] in the last nSlices slices.
+  // nSlices = 0 means all slices in the ring
+  uint64_t Integral(uint32_t nSlices, int x1, int x2, int y1, int y2) const;
+
+  uint32_t GetDepth() const { return fSlices.size(); };
+  uint32_t GetNSlices() const { return fNSlices; };
+  uint64_t GetEntries(uint32_t nSlices) const;
+
+ private:
+  struct SliceBin_t {
+    uint16_t x;
+    uint16_t y;
+    uint32_t count;
+  };
+  struct Slice_t {
+    std::vector<SliceBin_t> bins;
+    uint64_t entries;
+  };
+
+  std::vector<Slice_t> fSlices;
+  uint32_t fHead;  // Next slice to be written
+  uint32_t fNSlices;
+
+  // i = 0 is the newest
+  const Slice_t &GetSlice(uint32_t i) const
+  {
+    return fSlices[(fHead + fSlices.size() - 1 - i) % fSlices.size()];
+  };
+};
+
+#endif
@@ -0,0 +1,63 @@
+#ifndef TMETRICS_HPP
+#define TMETRICS_HPP 1
+
+// Metrics of the pipeline in the Prometheus text format.
+// TLatencyHist is filled by only one thread (e.g. one TEventProcessor)
+// without lock.  Each thread has its own one.
+// TPolarimeter collects them after each analysis, and TMetrics writes all
+// into a file for the textfile collector of node_exporter.
+
+#include <atomic>
+#include <cstdint>
+#include <sstream>
+#include <string>
+
+// Merged counts of TLatencyHist
+struct LatencyStat_t {
+  static constexpr int kNBuckets = 24;
+  uint64_t counts[kNBuckets];  // Not cumulative
+  double sum;                  // [s]
+};
+
+// Bucket i is up to 1 us * 2^i, the last one is +Inf
+class TLatencyHist
+{
+ public:
+  TLatencyHist();
+
+  // Only one thread may call it.  n observations of sec each, e.g. the
+  // events of one batch with the mean time.  _count and _sum are per event
+  void Observe(double sec, uint64_t n = 1);
+  // Any thread
+  void AddTo(LatencyStat_t &stat) const;
+
+  static double GetUpperBound(int i) { return 1.e-6 * (uint64_t(1) << i); };
+
+ private:
+  // Only the owner writes, so the load and store are enough
+  std::atomic<uint64_t> fCounts[LatencyStat_t::kNBuckets];
+  std::atomic<double> fSum;
+};
+
+class TMetrics
+{
+ public:
+  TMetrics(const std::string &fileName);
+  ~TMetrics() {}
+
+  // Call Clear(), Add*() of all metrics, then Write()
+  void Clear();
+  void AddCounter(const char *name, const char *help, double val);
+  void AddGauge(const char *name, const char *help, double val);
+  void AddHistogram(const char *name, const char *help,
+                    const LatencyStat_t &stat);
+  // Replaced at once.  The collector never reads a half file
+  bool Write();
+
+ private:
+  std::string fFileName;
+  std::ostringstream fText;
+  void AddHeader(const char *name, const char *help, const char *type);
+};
+
+#endif
@@ -0,0 +1,82 @@
+#ifndef TMONITOR_HPP
+#define TMONITOR_HPP 1
+
+// HTTP monitor of the histograms and the results (THttpServer).
+// The server shows the snapshot copies, not the histograms of the
+// analysis.  Update() copies them after the analysis, only when somebody
+// looked at the monitor recently, and never waits for the server.
+// The server lives in the own thread of TMonitor: it is made, used and
+// deleted only there, because THttpServer processes the requests in the
+// thread which made it.  The thread processes the requests every
+// SetRequestPeriod() ms, and gives the new snapshot to the server.  The
+// responses are cached until the next snapshot, so refreshing the viewer
+// costs nothing for the analysis and the processing threads.
+// ROOT 6.16 or newer (THttpCallArg by shared_ptr in ProcessRequest())
+
+#include <atomic>
+#include <ctime>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include <TGraph.h>
+#include <TH2.h>
+
+#include "TAsymmetry.hpp"
+
+class TMonitorServer;
+
+class TMonitor
+{
+ public:
+  // engine of THttpServer, e.g. "http:8080" or "http:127.0.0.1:8080"
+  TMonitor(const std::string &engine);
+  ~TMonitor();
+
+  void SetRequestPeriod(uint32_t val) { fRequestPeriod = val; };  // ms
+  // Minimum time between the snapshots [s]
+  void SetSnapshotInterval(uint32_t val) { fSnapshotInterval = val; };
+
+  void Start();
+  void Stop();
+
+  // Called by the analysis thread after each analysis.  hists and planes
+  // are in, out1 and out2
+  void Update(const TH2 *hists[3], const TAsymmetry *planes[3],
+              const double yields[3]);
+
+ private:
+  std::string fEngine;
+
+  std::unique_ptr<TH2D> fHists[3];
+  std::unique_ptr<TGraph> fAsymmetry[2];
+  // Text items of the results (path, value)
+  std::vector<std::pair<std::string, double>> fValues;
+  // Asymmetries of all analyses (time, out1, out2).  Only the analysis
+  // thread touches it
+  std::deque<double> fHistory[3];
+  time_t fSnapshotTime;
+  uint32_t fSnapshotInterval;
+  bool fNewSnapshot;  // Not given to the server yet
+  void TakeSnapshot(const TH2 *hists[3], const TAsymmetry *planes[3],
+                    const double yields[3]);
+
+  // Only Loop() touches the server
+  std::unique_ptr<TMonitorServer> fServer;
+  bool fHistsRegistered;
+  void Publish();
+
+  std::mutex fMutex;  // Snapshots, and the server using them
+  std::atomic<time_t> fLastRequest;
+  std::atomic<bool> fServing;
+  uint32_t fRequestPeriod;
+  std::thread fThread;
+  std::atomic<bool> fRunning;
+  void Loop();
+};
+
+#endif
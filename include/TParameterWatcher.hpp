@@ -0,0 +1,65 @@
+#ifndef TPARAMETERWATCHER_HPP
+#define TPARAMETERWATCHER_HPP 1
+
+// Reading the parameters from the newest document of GBS.PolMeterPar.
+// The thread started by Start() polls the collection, and keeps the new
+// parameters until GetNew() takes them.  A document which can not be
+// parsed is reported and ignored.
+// mongocxx::instance should be made before (see main.cpp).
+
+#include <atomic>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+
+#include <mongocxx/client.hpp>
+
+#include "TWaveRecord.hpp"
+
+struct PolMeterPar_t {
+  PolPar_t board;  // Reconfiguring the digitizer when changed
+  // Only for TEventProcessor.  board.th is also the processing threshold
+  uint16_t shortGate;
+  uint16_t longGate;
+  uint16_t CFDThreshold;
+};
+
+class TParameterWatcher
+{
+ public:
+  TParameterWatcher(const std::string &uri);
+  ~TParameterWatcher();
+
+  // Reading the newest document now.  Only the fields in the document are
+  // changed, others (e.g. recordLength) stay as given
+  bool Read(PolMeterPar_t &par);
+
+  // Polling interval [s].  Default 5
+  void SetInterval(uint32_t val) { fInterval = val; };
+  // par is the parameters in use.  The fields not in the document are
+  // taken from it
+  void Start(const PolMeterPar_t &par);
+  void Stop();
+  // true and the new parameters, when the document was changed
+  bool GetNew(PolMeterPar_t &par);
+
+ private:
+  std::string fURI;
+  // Kept for the polling.  Made again after an error
+  std::unique_ptr<mongocxx::client> fClient;
+  std::string fLastDocument;  // JSON of the last read document
+
+  std::mutex fMutex;
+  std::condition_variable fCond;
+  PolMeterPar_t fPar;
+  std::atomic<bool> fNewFlag;
+
+  std::thread fThread;
+  std::atomic<bool> fRunning;
+  uint32_t fInterval;
+  void Loop();
+};
+
+#endif
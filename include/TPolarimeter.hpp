@@ -1,46 +1,98 @@
 #ifndef TPOLARIMETER_HPP
 #define TPOLARIMETER_HPP 1
 
-#include <deque>
+#include <atomic>
+#include <chrono>
 #include <memory>
 #include <mutex>
+#include <string>
+#include <thread>
 #include <vector>
 
 #include <TCanvas.h>
 #include <TH2.h>
 
 #include "TAsymmetry.hpp"
+#include "TEventProcessor.hpp"
+#include "TFastHist2D.hpp"
+#include "THistRing.hpp"
+#include "TMetrics.hpp"
+#include "TMonitor.hpp"
+#include "TParameterWatcher.hpp"
+#include "TUploader.hpp"
+#include "TWaveBlock.hpp"
 #include "TWaveRecord.hpp"
 
-class BeamData_t
-{
- public:
-  std::vector<short> in;
-  std::vector<short> out1;
-  std::vector<short> out2;
-  std::vector<short> beam;
-};
-
 class TPolarimeter
 {
  public:
   TPolarimeter();
   TPolarimeter(uint16_t link);
+  // Taking the ownership.  e.g. TWaveEmulator for the test without board
+  TPolarimeter(TWaveRecord *digitizer);
   ~TPolarimeter();
 
-  void SetParameter(PolPar_t par) { fDigitizer->LoadParameters(par); };
+  void SetParameter(PolPar_t par);
+  // Board parameters, gates, threshold and CFD threshold
+  void SetParameter(const PolMeterPar_t &par);
+  // Taking the ownership.  New parameters are applied while running.
+  // Gates and CFD threshold are given to the processors at the next batch.
+  // The digitizer is configured again only when the board ones are changed
+  void SetParameterWatcher(TParameterWatcher *watcher);
   void SetShortGate(uint16_t val) { fShortGate = val; };
   void SetLongGate(uint16_t val) { fLongGate = val; };
   void SetThreshold(uint16_t val) { fThreshold = val; };
   void SetCFDThreshold(uint16_t val) { fCFDThreshold = val; };
+  // Also the length of one slice of the ring
   void SetTimeInterval(uint16_t val) { fTimeInterval = val; };
+  // Number of slices kept, and the slices of the rolling window
+  void SetRingDepth(uint32_t val);
+  void SetWindowSlices(uint32_t val) { fWindowSlices = val; };
+  // TAsymmetry without TSpectrum and TF1, and the check of it every tick
+  void SetFastMode(bool flag);
+  void SetFastModeCheck(bool flag) { fFastModeCheck = flag; };
+  // Cuts are derived every nTicks analysis ticks, and pushed to the
+  // processors.  The yields of the other ticks are counted by them.
+  // 0 (default) derives on every tick
+  void SetStreamTicks(uint32_t nTicks) { fStreamTicks = nTicks; };
+  // No drawing in the analysis loop.  The canvas is drawn only when
+  // GetCanvas() is called, e.g. for saving the plots
+  void SetHeadless(bool flag);
+  // Drawn again if the analysis was done after the last drawing
+  TCanvas *GetCanvas();
+  // Results are uploaded to "GBS.PolMeterResult" of this server
+  void SetDBURI(const std::string &uri);
+  // Results are written to this file first, and uploaded from it.  The
+  // ones not uploaded are kept for the next run.  Default
+  // "PolMeterResult.spool" of 256 MB.  Empty fileName keeps them in memory
+  void SetSpool(const std::string &fileName, uint64_t size);
+  // Histograms are uploaded as the change from the previous upload.  Every
+  // nUploads uploads (and after a dropped upload), the full histograms are
+  // uploaded as the key.  0 uploads the full ones always.  Default 60
+  void SetKeyInterval(uint32_t nUploads) { fKeyInterval = nUploads; };
+  // HTTP monitor of the histograms and results, e.g. "http:8080"
+  void SetMonitor(const std::string &engine);
+  // Metrics are written to the file after each analysis (Prometheus text
+  // format), e.g. for the textfile collector of node_exporter
+  void SetMetricsFile(const std::string &fileName);
+  // Number of batches in the queue of each processing thread
+  void SetQueueSize(uint32_t val) { fQueueSize = val; };
+  void SetNThreads(uint32_t val) { fNThreads = val; };
+  // Events in one batch (one BLT read).  Call after SetParameter
+  void SetBatchSize(uint32_t val);
+  void SetNReadoutBuffers(uint32_t val)
+  {
+    fDigitizer->SetNReadoutBuffers(val);
+  };
 
   void StartAcquisition();
   void StopAcquisition();
+  void Run();
   void DummyRun();
 
  private:
   std::unique_ptr<TWaveRecord> fDigitizer;
+  PolPar_t fBoardPar;
   uint16_t fShortGate;
   uint16_t fLongGate;
   uint16_t fThreshold;
@@ -49,26 +101,96 @@ class TPolarimeter
   time_t fLastTime;
 
   std::unique_ptr<TCanvas> fCanvas;
+  std::unique_ptr<TMonitor> fMonitor;
+  bool fHeadless;
+  bool fCanvasDirty;
 
   std::unique_ptr<TH2D> fHisIn;
   std::unique_ptr<TH2D> fHisOut1;
   std::unique_ptr<TH2D> fHisOut2;
 
+  // Events since the last analysis, merged from all processors
+  std::unique_ptr<TFastHist2D> fDeltaIn;
+  std::unique_ptr<TFastHist2D> fDeltaOut1;
+  std::unique_ptr<TFastHist2D> fDeltaOut2;
+
+  // Deltas of the last intervals for the rolling window and the current
+  // slice asymmetry.  The full run is fInPlane etc.
+  std::unique_ptr<THistRing> fRingIn;
+  std::unique_ptr<THistRing> fRingOut1;
+  std::unique_ptr<THistRing> fRingOut2;
+  uint32_t fWindowSlices;
+  bool fFastModeCheck;
+
+  uint32_t fStreamTicks;
+  uint64_t fTickCounter;
+  double fBaseYield[3];  // Yields when the cuts were pushed
+  void DeriveYields(double &yieldIn, double &yieldOut1, double &yieldOut2);
+  void PushYieldCuts(double yieldIn, double yieldOut1, double yieldOut2);
+  void GetStreamYields(double &yieldIn, double &yieldOut1, double &yieldOut2);
+  void PrintWindow(const char *label, uint32_t nSlices);
+
   std::unique_ptr<TAsymmetry> fInPlane;
   std::unique_ptr<TAsymmetry> fOutPlane1;
   std::unique_ptr<TAsymmetry> fOutPlane2;
 
   int kbhit();
+  // producer is ReadData or FetchDummyData
+  void MainLoop(void (TPolarimeter::*producer)());
+  void ReadData();
   void FetchDummyData();
-  void FillHists();
   void TimeCheck();
   void Analysis();
   void PlotHists();
   void UploadResults();
+  std::unique_ptr<TUploader> fUploader;
+  std::string fSpoolName;
+  uint64_t fSpoolSize;
+  double fYield[3];  // Yields of the last analysis, for the upload
+  // Events since the last upload
+  std::unique_ptr<TFastHist2D> fUploadIn;
+  std::unique_ptr<TFastHist2D> fUploadOut1;
+  std::unique_ptr<TFastHist2D> fUploadOut2;
+  std::string fRunID;
+  int64_t fSequence;  // Of the upload in the run, from 0
+  uint32_t fKeyInterval;
+  uint64_t fLastDropped;  // Dropped uploads at the last key
+
+  // ReadData or FetchDummyData (producer) -> TEventProcessor (consumers)
+  // One slot is one whole BLT batch.  Batches are given in round robin.
+  std::vector<std::unique_ptr<TEventProcessor>> fProcessors;
+  uint32_t fNThreads;
+  uint32_t fNextProcessor;
+  uint32_t fQueueSize;
+  uint32_t fBatchSize;
+  uint32_t fRecordLength;
+  void CreateProcessors();
+  TEventProcessor *FindFreeProcessor();
+
+  // Read and processed rates
+  std::atomic<uint64_t> fReadCounter;
+  std::atomic<uint64_t> fDropCounter;
+  std::chrono::steady_clock::time_point fRateTime;
+  void PrintRates();
+
+  // Totals since the start, for the metrics
+  uint64_t fTotalRead;
+  uint64_t fTotalProcessed;
+  uint64_t fTotalDropped;
+  TLatencyHist fReadLatency;      // ReadEvents() with events
+  TLatencyHist fAnalysisLatency;  // Analysis()
+  TLatencyHist fUploadLatency;    // UploadResults()
+  std::unique_ptr<TMetrics> fMetrics;
+  void ExportMetrics(uint32_t occupancy, uint32_t capacity,
+                     uint32_t highWaterMark, const UploadStat_t &upload);
+
+  std::atomic<bool> fAcqFlag;
+  std::atomic<bool> fReadFlag;  // Only the producer is stopped by false
 
-  std::deque<BeamData_t> fQueue;
-  std::mutex fMutex;
-  bool fAcqFlag;
+  std::unique_ptr<TParameterWatcher> fWatcher;
+  PolMeterPar_t GetParameters() const;
+  void UpdateParameters(const PolMeterPar_t &par, std::thread &producer,
+                        void (TPolarimeter::*produce)());
 };
 
 #endif
@@ -0,0 +1,113 @@
+#ifndef TRINGBUFFER_HPP
+#define TRINGBUFFER_HPP 1
+
+// Bounded single-producer/single-consumer ring of preallocated slots.
+// The producer fills the slot given by GetWriteSlot() and publishes it by
+// Push().  The consumer reads the slot given by GetReadSlot() and gives it
+// back by Pop().  Slots are reused, no lock and no allocation after the
+// construction.  Only ONE thread may produce and ONE thread may consume.
+
+#include <atomic>
+#include <cstdint>
+#include <vector>
+
+template <typename T>
+class TRingBuffer
+{
+ public:
+  // size is rounded up to the power of 2
+  TRingBuffer(uint32_t size, const T &prototype = T());
+  ~TRingBuffer() {}
+
+  // Producer side.  nullptr means the ring is full
+  T *GetWriteSlot();
+  void Push();
+
+  // Consumer side.  nullptr means the ring is empty
+  T *GetReadSlot();
+  void Pop();
+
+  uint32_t GetCapacity() const { return fMask + 1; };
+  uint32_t GetOccupancy() const
+  {
+    return fHead.load(std::memory_order_acquire) -
+           fTail.load(std::memory_order_acquire);
+  };
+  uint32_t GetHighWaterMark() const
+  {
+    return fHighWaterMark.load(std::memory_order_relaxed);
+  };
+  void ResetHighWaterMark() { fHighWaterMark.store(0); };
+
+ private:
+  static constexpr uint32_t kCacheLine = 64;
+
+  std::vector<T> fSlots;
+  uint64_t fMask;
+
+  // Producer and consumer indices live in separated cache lines.
+  // Each side keeps a cached copy of the other index to avoid touching
+  // the other cache line for every slot.
+  char fPad0[kCacheLine];
+  std::atomic<uint64_t> fHead;
+  uint64_t fTailCache;
+  std::atomic<uint32_t> fHighWaterMark;
+  char fPad1[kCacheLine];
+  std::atomic<uint64_t> fTail;
+  uint64_t fHeadCache;
+  char fPad2[kCacheLine];
+};
+
+template <typename T>
+TRingBuffer<T>::TRingBuffer(uint32_t size, const T &prototype)
+    : fHead(0), fTailCache(0), fHighWaterMark(0), fTail(0), fHeadCache(0)
+{
+  uint64_t capacity = 1;
+  while (capacity < size) capacity <<= 1;
+  fMask = capacity - 1;
+  fSlots.resize(capacity, prototype);
+}
+
+template <typename T>
+T *TRingBuffer<T>::GetWriteSlot()
+{
+  const auto head = fHead.load(std::memory_order_relaxed);
+  if (head - fTailCache > fMask) {
+    fTailCache = fTail.load(std::memory_order_acquire);
+    if (head - fTailCache > fMask) return nullptr;
+  }
+
+  return &fSlots[head & fMask];
+}
+
+template <typename T>
+void TRingBuffer<T>::Push()
+{
+  const auto head = fHead.load(std::memory_order_relaxed) + 1;
+  fHead.store(head, std::memory_order_release);
+
+  const uint32_t occupancy = head - fTail.load(std::memory_order_relaxed);
+  if (occupancy > fHighWaterMark.load(std::memory_order_relaxed))
+    fHighWaterMark.store(occupancy, std::memory_order_relaxed);
+}
+
+template <typename T>
+T *TRingBuffer<T>::GetReadSlot()
+{
+  const auto tail = fTail.load(std::memory_order_relaxed);
+  if (tail == fHeadCache) {
+    fHeadCache = fHead.load(std::memory_order_acquire);
+    if (tail == fHeadCache) return nullptr;
+  }
+
+  return &fSlots[tail & fMask];
+}
+
+template <typename T>
+void TRingBuffer<T>::Pop()
+{
+  const auto tail = fTail.load(std::memory_order_relaxed) + 1;
+  fTail.store(tail, std::memory_order_release);
+}
+
+#endif
@@ -1,6 +1,7 @@
 #ifndef TSIGNAL_HPP
 #define TSIGNAL_HPP 1
 
+#include <cstdint>
 #include <memory>
 #include <vector>
 
@@ -9,6 +10,27 @@
 #include <TGraph.h>
 #include <TLine.h>
 
+// Results of TSignal::ProcessBatch().  One element for one waveform
+struct SignalBatch_t {
+  std::vector<double> trgTime;
+  std::vector<double> shortCharge;
+  std::vector<double> longCharge;
+  std::vector<double> pulseHeight;
+
+  void Resize(uint32_t n)
+  {
+    trgTime.resize(n);
+    shortCharge.resize(n);
+    longCharge.resize(n);
+    pulseHeight.resize(n);
+  };
+};
+
+// Compile time specialized ProcessBatch().  See TFixedSignal.hpp
+typedef void (*FixedBatchFunc_t)(const short *data, uint32_t nWaveforms,
+                                 double threshold, double cfd,
+                                 SignalBatch_t &result);
+
 class TSignal
 {
  public:
@@ -17,13 +39,38 @@ class TSignal
           int longGate);
   ~TSignal();
 
-  void ProcessSignal();
+  // Fused and vectorized
+  virtual void ProcessSignal();
+  // Reference implementation with the Cal* functions
+  virtual void ProcessSignalScalar();
+  // nWaveforms contiguous waveforms of recordLength (e.g. one channel of
+  // TWaveBlock).  No virtual call for each waveform
+  void ProcessBatch(const short *data, uint32_t nWaveforms,
+                    uint32_t recordLength, SignalBatch_t &result);
   virtual void Plot();
 
-  virtual void SetSignal(std::vector<short> *signal) { fSignal = signal; };
-  void SetShortGate(double shortGate) { fShortGate = shortGate; };
-  void SetLongGate(double longGate) { fLongGate = longGate; };
+  // View of the waveform.  No copy
+  virtual void SetSignal(const short *signal, uint32_t size)
+  {
+    fSignal = signal;
+    fSize = size;
+  };
+  void SetSignal(std::vector<short> *signal)
+  {
+    SetSignal(signal->data(), signal->size());
+  };
+  void SetShortGate(double shortGate)
+  {
+    fShortGate = shortGate;
+    fFixedLength = 0;
+  };
+  void SetLongGate(double longGate)
+  {
+    fLongGate = longGate;
+    fFixedLength = 0;
+  };
   void SetThreshold(double th) { fThreshold = th; };
+  void SetCFDThreshold(double cfd) { fCFDThreshold = cfd; };
 
   double GetTrgTime() { return fTrgTime; };
   double GetShortCharge() { return fShortCharge; };
@@ -31,7 +78,8 @@ class TSignal
   double GetPulseHeight() { return fPulseHeight; };
 
  protected:
-  std::vector<short> *fSignal;
+  const short *fSignal;
+  uint32_t fSize;
   int fShortGate;
   int fLongGate;
   int fRewind;  // trigger - fRewind = start of integration
@@ -52,6 +100,15 @@ class TSignal
   virtual void CalPulseHeight();
   double fPulseHeight;
 
+  // Specialized ProcessBatch() for fFixedLength and the gates
+  FixedBatchFunc_t fFixedFunc;
+  uint32_t fFixedLength;
+
+  // Core of ProcessSignal() and ProcessBatch()
+  void ProcessOne(const short *signal, int size, double &baseLine,
+                  double &trgTime, double &shortCharge, double &longCharge,
+                  double &pulseHeight) const;
+
   template <typename T>
   void SetPosition(T &obj, double x1, double y1, double x2, double y2);
 
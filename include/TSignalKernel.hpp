@@ -0,0 +1,25 @@
+#ifndef TSIGNALKERNEL_HPP
+#define TSIGNALKERNEL_HPP 1
+
+// Vectorized loops over the waveform for TSignal and TBeamSignal.
+// AVX-512BW or AVX2 is chosen at compile time (-march=native),
+// otherwise the scalar loops are used.  All results are integer, and
+// same as the scalar loops.
+
+#include <cstdint>
+
+class TSignalKernel
+{
+ public:
+  // Sum of data[begin, end)
+  static int64_t Sum(const short *data, int begin, int end);
+
+  static short Min(const short *data, int size);
+  static void MinMax(const short *data, int size, short &min, short &max);
+
+  // First i in [0, size - 1) with data[i] >= upper && data[i + 1] <= lower.
+  // -1 means not found.
+  static int FindCrossing(const short *data, int size, int upper, int lower);
+};
+
+#endif
@@ -0,0 +1,58 @@
+#ifndef TSPOOL_HPP
+#define TSPOOL_HPP 1
+
+// Append-only log of records in a memory-mapped file of fixed size.
+// Records are written after the last one, and taken from the read offset
+// after they are uploaded.  The file is used as a ring, so the disk use is
+// fixed.  When it is full, the oldest records are dropped.
+// The offsets are in the header of the file.  Each record has a CRC, and
+// the records after a broken one are discarded when the file is opened.
+// The records are kept in a crash of the process (the pages are in the
+// page cache).  A power loss can lose the last records.
+// Not thread safe.  The user locks it.
+
+#include <cstdint>
+#include <string>
+
+class TSpool
+{
+ public:
+  // Empty fileName, a file which can not be opened, or a file locked by
+  // another process: the memory is used, and the records are lost at the
+  // exit
+  TSpool(const std::string &fileName, uint64_t size);
+  ~TSpool();
+
+  bool IsPersistent() const { return fFD >= 0; };
+
+  // Returns the number of dropped records (oldest ones, or this one when
+  // it is larger than the spool)
+  uint32_t Append(const uint8_t *data, uint32_t size);
+
+  // Record at offset.  offset is moved to the next one.  data is valid
+  // until the next Append().  false when no record is left
+  bool Read(uint64_t &offset, const uint8_t *&data, uint32_t &size) const;
+  uint64_t GetReadOffset() const;
+  // The records before offset are done
+  void Commit(uint64_t offset);
+
+  uint32_t GetNRecords() const { return fNRecords; };
+  uint64_t GetUsedBytes() const;
+  uint64_t GetCapacity() const { return fCapacity; };
+
+ private:
+  int fFD;
+  uint8_t *fMap;
+  uint64_t fMapSize;
+  uint64_t fCapacity;  // Bytes for the records, after the header
+  uint32_t fNRecords;
+
+  struct Header_t;
+  Header_t *fHeader;
+  uint8_t *fData;
+
+  void Recover();
+  void DropOldest();
+};
+
+#endif
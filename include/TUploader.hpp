@@ -0,0 +1,85 @@
+#ifndef TUPLOADER_HPP
+#define TUPLOADER_HPP 1
+
+// Uploading result documents to MongoDB in its own thread.
+// The connection is kept for the run, and made again after an error.
+// Push() never waits for the DB.  The documents are written to the spool
+// file (TSpool), and inserted by insert_many in batches.  They are removed
+// from the spool after the insert.  A failed batch is retried with backoff.
+// The documents left at the exit or a crash are uploaded by the next run.
+// When the spool is full, the oldest document is dropped.
+// mongocxx::instance should be made before Start() (see main.cpp).
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <bsoncxx/document/value.hpp>
+#include <mongocxx/client.hpp>
+
+#include "TMetrics.hpp"
+#include "TSpool.hpp"
+
+struct UploadStat_t {
+  uint32_t queueDepth;  // Documents in the spool
+  uint64_t spoolBytes;
+  uint64_t nUploaded;
+  uint64_t nDropped;
+  uint64_t nFailures;
+  double lastLatency;  // ms of the last insert_many
+  double maxLatency;
+};
+
+class TUploader
+{
+ public:
+  TUploader(const std::string &uri, const std::string &dbName,
+            const std::string &collectionName);
+  ~TUploader();
+
+  // Call before Start().  Empty fileName keeps the documents in memory
+  void SetSpool(const std::string &fileName, uint64_t size)
+  {
+    fSpoolName = fileName;
+    fSpoolSize = size;
+  };
+  void SetBatchSize(uint32_t val) { fBatchSize = val; };
+
+  void Start();
+  // The remaining documents are tried once.  Left in the spool on failure
+  void Stop();
+
+  void Push(bsoncxx::document::value doc);
+
+  UploadStat_t GetStat();
+  // Time of the successful insert_many
+  const TLatencyHist &GetInsertLatency() const { return fInsertLatency; };
+
+ private:
+  std::string fURI;
+  std::string fDBName;
+  std::string fCollectionName;
+  // Only used by the upload thread
+  std::unique_ptr<mongocxx::client> fClient;
+
+  std::string fSpoolName;
+  uint64_t fSpoolSize;
+  uint32_t fBatchSize;
+  std::unique_ptr<TSpool> fSpool;
+  std::mutex fMutex;  // fSpool and fStat
+  std::condition_variable fCond;
+  UploadStat_t fStat;
+  TLatencyHist fInsertLatency;  // Only the upload thread fills it
+
+  std::thread fThread;
+  std::atomic<bool> fRunning;
+  void Loop();
+  bool Insert(const std::vector<bsoncxx::document::value> &batch);
+};
+
+#endif
@@ -0,0 +1,61 @@
+#ifndef TWAVEBLOCK_HPP
+#define TWAVEBLOCK_HPP 1
+
+// Structure of arrays for one BLT read.
+// Each channel has one contiguous sample array of
+// maxEvents * recordLength samples, event by event.
+// Users take pointers (views) into the block, not copies.
+
+#include <cstdint>
+#include <vector>
+
+class TWaveBlock
+{
+ public:
+  enum Channel_t { kIn = 0, kOut1, kOut2, kBeam, kNChs };
+
+  TWaveBlock();
+  TWaveBlock(uint32_t maxEvents, uint32_t recordLength);
+  ~TWaveBlock();
+
+  void Allocate(uint32_t maxEvents, uint32_t recordLength);
+  void Clear() { fNEvents = 0; };
+  // Exchanging the buffers.  Used to hand over a block without copy
+  void Swap(TWaveBlock &block);
+
+  // Adding one event returns the index of the event
+  bool IsFull() const { return fNEvents >= fMaxEvents; };
+  uint32_t AddEvent(uint64_t time)
+  {
+    fTime[fNEvents] = time;
+    return fNEvents++;
+  };
+
+  short *GetTrace(Channel_t ch, uint32_t iEve)
+  {
+    return &fSamples[ch][iEve * fRecordLength];
+  };
+  const short *GetTrace(Channel_t ch, uint32_t iEve) const
+  {
+    return &fSamples[ch][iEve * fRecordLength];
+  };
+  // Whole block of one channel.  GetNEvents() waveforms of GetRecordLength()
+  const short *GetChannel(Channel_t ch) const { return fSamples[ch].data(); };
+
+  uint64_t GetTime(uint32_t iEve) const { return fTime[iEve]; };
+  const uint64_t *GetTimeArray() const { return fTime.data(); };
+
+  uint32_t GetNEvents() const { return fNEvents; };
+  uint32_t GetMaxEvents() const { return fMaxEvents; };
+  uint32_t GetRecordLength() const { return fRecordLength; };
+
+ private:
+  uint32_t fNEvents;
+  uint32_t fMaxEvents;
+  uint32_t fRecordLength;
+
+  std::vector<short> fSamples[kNChs];
+  std::vector<uint64_t> fTime;
+};
+
+#endif
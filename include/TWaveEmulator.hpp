@@ -0,0 +1,62 @@
+#ifndef TWaveEmulator_hpp
+#define TWaveEmulator_hpp 1
+
+// Software digitizer for the test without the board.
+// Same interface and same data layout (TWaveBlock) as TWaveRecord.
+// PSD like pulses (gamma and neutron), beam trigger and baseline noise are
+// generated.
+
+#include <chrono>
+#include <random>
+#include <vector>
+
+#include "TWaveRecord.hpp"
+
+class TWaveEmulator : public TWaveRecord
+{
+ public:
+  TWaveEmulator();
+  virtual ~TWaveEmulator();
+
+  void Initialize();
+
+  void ReadEvents();
+
+  CAEN_DGTZ_ErrorCode StartAcquisition();
+  void StopAcquisition();
+
+  // 0 means as fast as possible
+  void SetRate(double val) { fRate = val; };
+  void SetPileUpFraction(double val) { fPileUpFraction = val; };
+  void SetNeutronFraction(double val) { fNeutronFraction = val; };
+  void SetNoise(double val) { fNoise = val; };
+  void SetSeed(uint32_t val) { fRandom.seed(val); };
+
+ private:
+  double fRate;  // Hz
+  double fPileUpFraction;
+  double fNeutronFraction;
+  double fNoise;  // sigma in ADC channel
+
+  std::mt19937 fRandom;
+  std::uniform_real_distribution<double> fUniform;
+
+  double fBaseLine;
+  int fTrgPos;  // Trigger position in the record (samples)
+
+  // Pulse shapes with amplitude 1.  Noise is taken from a table to keep
+  // the generation cheaper than the processing.
+  std::vector<double> fGammaShape;
+  std::vector<double> fNeutronShape;
+  std::vector<short> fNoiseTable;
+  void MakeShapes();
+
+  void GenerateEvent(uint32_t index);
+  void AddPulse(short *trace, const std::vector<double> &shape, int start,
+                double amplitude);
+
+  uint64_t fTime;  // ns
+  std::chrono::steady_clock::time_point fLastRead;
+};
+
+#endif
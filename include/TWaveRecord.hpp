@@ -4,22 +4,20 @@
 // For the standard fiemware digitizer
 // This will be super class of other firmware and model family
 
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
 #include <string>
+#include <thread>
 #include <vector>
 
 #include <CAENDigitizer.h>
 #include <CAENDigitizerType.h>
 
 #include "TDigitizer.hpp"
-
-struct HitData_t {
-  uint16_t mod;
-  uint64_t time;
-  std::vector<uint16_t> inPlane;
-  std::vector<uint16_t> outPlane1;
-  std::vector<uint16_t> outPlane2;
-  std::vector<uint16_t> beamTrg;
-};
+#include "TWaveBlock.hpp"
 
 struct PolPar_t {
   double DCOffset;
@@ -37,6 +35,13 @@ struct PolPar_t {
   uint16_t postTriggerSize;
 };
 
+struct ReadoutStat_t {
+  double bandwidth;    // MB/s read through the link
+  double utilization;  // Fraction of time in ReadData with data
+  double stall;        // Fraction of time no free buffer (decode is behind)
+  uint64_t nReads;
+};
+
 class TWaveRecord : public TDigitizer
 {
  public:
@@ -55,7 +60,18 @@ class TWaveRecord : public TDigitizer
   uint32_t GetNEvents() { return fEveCounter; };
 
   void LoadParameters(PolPar_t par);
-  std::vector<HitData_t> &GetDataVec() { return fDataVec; };
+  // Max number of events in one read.  Set before Initialize()
+  void SetBLTEvents(uint32_t n) { fBLTEvents = n; };
+  // Filled by ReadEvents().  Valid until the next ReadEvents()
+  TWaveBlock &GetWaveBlock() { return fBlock; };
+
+  // 2 or more buffers enables the asynchronous readout.
+  // One thread runs ReadData into the free buffers, and ReadEvents() only
+  // decodes the filled buffers.  Set before Initialize().
+  void SetNReadoutBuffers(uint32_t n) { fNReadoutBuffers = n; };
+  bool IsAsyncReadout() const { return fNReadoutBuffers > 1; };
+  // Statistics since the last call
+  ReadoutStat_t GetReadoutStat();
 
  protected:
   // For event readout
@@ -81,7 +97,7 @@ class TWaveRecord : public TDigitizer
   // Data
   uint64_t fTimeOffset;
   uint64_t fPreviousTime;
-  std::vector<HitData_t> fDataVec;
+  TWaveBlock fBlock;
 
   uint16_t fInCh;
   uint16_t fOutCh1;
@@ -90,6 +106,29 @@ class TWaveRecord : public TDigitizer
 
   void SetParameters();
 
+  void DecodeBuffer(char *buffer, uint32_t size);
+
+  // For asynchronous readout
+  uint32_t fNReadoutBuffers;
+  std::vector<char *> fReadoutBuffers;
+  std::vector<uint32_t> fReadoutSizes;
+  std::deque<uint32_t> fFreeBuffers;
+  std::deque<uint32_t> fFilledBuffers;
+  std::mutex fBufferMutex;
+  std::condition_variable fBufferCond;
+  std::thread fReadoutThread;
+  std::atomic<bool> fReadoutFlag;
+  void ReadoutLoop();
+  void FreeReadoutBuffers();
+
+  std::atomic<uint64_t> fReadBytes;
+  std::atomic<uint64_t> fReadCounter;
+  std::atomic<uint64_t> fBusyTime;   // ns in ReadData with data
+  std::atomic<uint64_t> fStallTime;  // ns waiting for a free buffer
+  // steady_clock ticks.  Set by StartAcquisition() and GetReadoutStat()
+  // in the different threads
+  std::atomic<std::chrono::steady_clock::rep> fStatTime;
+
   void AcquisitionConfig();
   void TriggerConfig();
 };
@@ -1,18 +1,115 @@
+#include <algorithm>
+#include <chrono>
+#include <cmath>
 #include <iostream>
+#include <sstream>
+#include <vector>
 
 #include <TROOT.h>
 #include <TString.h>
 
 #include "TAsymmetry.hpp"
 
+namespace
+{
+// Gaussian smoothing of the bins [first, last].  Index 0 is the bin first
+std::vector<double> Smooth(const TH1 *hist, int first, int last, double sigma)
+{
+  std::vector<double> contents(last - first + 1);
+  for (auto bin = first; bin <= last; bin++)
+    contents[bin - first] = hist->GetBinContent(bin);
+
+  const auto halfWidth = int(std::ceil(3 * sigma));
+  std::vector<double> kernel(2 * halfWidth + 1);
+  for (auto i = -halfWidth; i <= halfWidth; i++)
+    kernel[i + halfWidth] = std::exp(-0.5 * i * i / (sigma * sigma));
+
+  const int size = contents.size();
+  std::vector<double> smoothed(size);
+  for (auto i = 0; i < size; i++) {
+    auto sum = 0.;
+    auto weight = 0.;
+    for (auto j = std::max(0, i - halfWidth);
+         j <= std::min(size - 1, i + halfWidth); j++) {
+      sum += kernel[j - i + halfWidth] * contents[j];
+      weight += kernel[j - i + halfWidth];
+    }
+    smoothed[i] = sum / weight;
+  }
+
+  return smoothed;
+}
+
+// Gaussian fit of the bins in [xMin, xMax] in closed form.
+// log(y) = a + b * u + c * u^2 (u = x - x0) is fitted by least squares.
+// The weight is y, the inverse of the variance of log(y).
+bool FitLogParabola(const TH1 *hist, double xMin, double xMax, double &mean,
+                    double &sigma)
+{
+  const auto x0 = (xMin + xMax) / 2.;
+  double sumW[5]{0.};     // sum of w * u^k
+  double sumWLog[3]{0.};  // sum of w * u^k * log(y)
+  auto nPoints = 0;
+  const auto nBins = hist->GetNbinsX();
+  for (auto bin = 1; bin <= nBins; bin++) {
+    const auto x = hist->GetBinCenter(bin);
+    const auto y = hist->GetBinContent(bin);
+    if (x < xMin || x > xMax || y <= 0.) continue;
+
+    const auto u = x - x0;
+    const auto logY = std::log(y);
+    auto wu = y;
+    for (auto k = 0; k < 5; k++) {
+      sumW[k] += wu;
+      if (k < 3) sumWLog[k] += wu * logY;
+      wu *= u;
+    }
+    nPoints++;
+  }
+  if (nPoints < 3) return false;
+
+  // Normal equation solved by Cramer's rule
+  auto det3 = [](double a, double b, double c, double d, double e, double f,
+                 double g, double h, double i) {
+    return a * (e * i - f * h) - b * (d * i - f * g) + c * (d * h - e * g);
+  };
+  const auto det = det3(sumW[0], sumW[1], sumW[2], sumW[1], sumW[2], sumW[3],
+                        sumW[2], sumW[3], sumW[4]);
+  if (det == 0.) return false;
+  const auto b = det3(sumW[0], sumWLog[0], sumW[2], sumW[1], sumWLog[1],
+                      sumW[3], sumW[2], sumWLog[2], sumW[4]) /
+                 det;
+  const auto c = det3(sumW[0], sumW[1], sumWLog[0], sumW[1], sumW[2],
+                      sumWLog[1], sumW[2], sumW[3], sumWLog[2]) /
+                 det;
+  if (c >= 0.) return false;  // Not a peak
+
+  mean = x0 - b / (2. * c);
+  sigma = std::sqrt(-1. / (2. * c));
+  return true;
+}
+}  // namespace
+
 TAsymmetry::TAsymmetry()
 {
   fPulseShapeTh = 0.;
   fTimeTh = 0.;
 
+  fPSCutBin = -1;
+  fSlowCutBin = -1;
+  fResultStartBin = -1;
+  fResultEndBin = -1;
+
   fIndex = 0;
 
+  fFastMode = false;
+  fPSPeak = 0.;
+  fPSSigma = 0.;
+  fTOFPeak = 0.;
+
   fTimeWindow = 4.;
+  fYieldStartBin = -1;
+  fYieldStopBin = -1;
 
   constexpr auto nPeaks = 1;
   fSpectrum.reset(new TSpectrum(nPeaks * 2));
@@ -41,8 +138,40 @@ void TAsymmetry::SetHist(const TH2 *hist)
   fHistPS.reset((TH1D *)hist->ProjectionY(Form("HistPS%02d", fIndex)));
   fHistPS->SetTitle("PS");
   fHistPS->SetDirectory(nullptr);
+
+  // Cut projections are made by the next DataAnalysis()
+  fHistPSCut.reset();
+  fHistResult.reset();
+  fHistSlowComponent.reset();
+  fPSCutBin = -1;
+  fSlowCutBin = -1;
+  fResultStartBin = -1;
+  fResultEndBin = -1;
 };
 
+void TAsymmetry::AddHist(const TFastHist2D &hist)
+{
+  for (auto bin : hist.GetFilledBins()) {
+    const double count = hist.GetBinContent(bin);
+    int binX, binY;
+    hist.GetBinXY(bin, binX, binY);
+
+    fHist->AddBinContent(bin, count);
+    fHistTime->AddBinContent(binX, count);
+    fHistPS->AddBinContent(binY, count);
+
+    // Same ranges as ProjectionX() and ProjectionY() in the cut functions
+    if (fHistPSCut && binY >= 1 && binY <= fPSCutBin)
+      fHistPSCut->AddBinContent(binX, count);
+    if (fHistResult && binY >= fResultStartBin && binY <= fResultEndBin)
+      fHistResult->AddBinContent(binX, count);
+    if (fHistSlowComponent && binX >= fSlowCutBin)
+      fHistSlowComponent->AddBinContent(binY, count);
+  }
+
+  fHist->SetEntries(fHist->GetEntries() + hist.GetEntries());
+}
+
 template <typename T>
 void TAsymmetry::SetPosition(T &obj, double x1, double y1, double x2, double y2)
 {
@@ -54,7 +183,8 @@ void TAsymmetry::SetPosition(T &obj, double x1, double y1, double x2, double y2)
 
 void TAsymmetry::Save(TString fileName)
 {
-  if (!fCanvas) Plot();
+  // Drawn here, nothing is drawn by the analysis
+  Plot();
   if (!fileName.EndsWith(".pdf")) fileName = fileName + ".pdf";
   fCanvas->Print(fileName, "pdf");
 }
@@ -103,11 +233,8 @@ void TAsymmetry::Plot()
     fVerLine->Draw("SAME");
     fHorLine->Draw("SAME");
 
-    auto peak = fFitFnc->GetParameter(1);
-    auto sigma = fFitFnc->GetParameter(2);
-    auto timePos = fSpectrum->GetPositionX()[0];
-    SetPosition(fArea, timePos - fTimeWindow / 2., peak - 3 * sigma,
-                timePos + fTimeWindow / 2., peak + 3 * sigma);
+    SetPosition(fArea, fTOFPeak - fTimeWindow / 2., fPSPeak - 3 * fPSSigma,
+                fTOFPeak + fTimeWindow / 2., fPSPeak + 3 * fPSSigma);
     fArea->Draw("SAME");
   }
   if (fHistPS) {
@@ -120,8 +247,8 @@ void TAsymmetry::Plot()
   }
   if (fHistResult) {
     fCanvas->cd(4);
-    // fHistResult->Draw();
-    fSpectrum->Search(fHistResult.get(), 2, "", fSpectrumTh);
+    // The peak is already found by Integral().  No search only for drawing
+    fHistResult->Draw();
     // fHistSlowComponent->Draw();
   }
 }
@@ -163,11 +290,8 @@ void TAsymmetry::DrawResult()
     fVerLine->Draw("SAME");
     fHorLine->Draw("SAME");
 
-    auto peak = fFitFnc->GetParameter(1);
-    auto sigma = fFitFnc->GetParameter(2);
-    auto timePos = fSpectrum->GetPositionX()[0];
-    SetPosition(fArea, timePos - fTimeWindow / 2., peak - 3 * sigma,
-                timePos + fTimeWindow / 2., peak + 3 * sigma);
+    SetPosition(fArea, fTOFPeak - fTimeWindow / 2., fPSPeak - 3 * fPSSigma,
+                fTOFPeak + fTimeWindow / 2., fPSPeak + 3 * fPSSigma);
     fArea->Draw("SAME");
   }
 }
@@ -181,20 +305,20 @@ void TAsymmetry::DataAnalysis()
 
 void TAsymmetry::TimeCut()
 {
-  if (!fHistResult) PulseShapeCut();
+  if (!fHistPSCut) PulseShapeCut();
+  if (!fHistPSCut) return;
 
   constexpr auto thRatio = 0.01;
-  const auto maxBin = fHistResult->GetMaximumBin();
-  const auto max = fHistResult->GetBinContent(maxBin);
+  const auto maxBin = fHistPSCut->GetMaximumBin();
+  const auto max = fHistPSCut->GetBinContent(maxBin);
   const auto th = max * thRatio;
-  const auto nBins = fHistResult->GetNbinsX();
+  const auto nBins = fHistPSCut->GetNbinsX();
 
   for (auto i = maxBin; i < nBins; i++) {
-    auto binContent = fHistResult->GetBinContent(i);
+    auto binContent = fHistPSCut->GetBinContent(i);
     if (binContent < th) {
-      fHistResult->GetXaxis()->SetRange(i, nBins);
       // std::cout << i << std::endl;
-      fTimeTh = fHistResult->GetBinCenter(i);
+      fTimeTh = fHistPSCut->GetBinCenter(i);
       break;
     }
   }
@@ -210,9 +334,12 @@ void TAsymmetry::PulseShapeCut()
   for (auto i = maxBin; i > 0; i--) {
     auto binContent = fHistPS->GetBinContent(i);
     if (binContent < th) {
-      fHistResult.reset(
-          fHist->ProjectionX(Form("HistResult%02d", fIndex), 1, i));
-      fHistResult->SetDirectory(nullptr);
+      if (!fHistPSCut || i != fPSCutBin) {
+        fHistPSCut.reset(
+            fHist->ProjectionX(Form("HistPSCut%02d", fIndex), 1, i));
+        fHistPSCut->SetDirectory(nullptr);
+        fPSCutBin = i;
+      }
       // fHistResult->Rebin(4);
       // std::cout << i << std::endl;
       fPulseShapeTh = fHistPS->GetBinCenter(i);
@@ -225,21 +352,81 @@ void TAsymmetry::PulseShapeCutLast()
 {
   if (fTimeTh == 0.) TimeCut();
   auto cut = fHist->GetXaxis()->FindBin(fTimeTh);
-  fHistSlowComponent.reset(
-      fHist->ProjectionY(Form("HistSlowComponent%02d", fIndex), cut));
-  fHistSlowComponent->SetDirectory(nullptr);
+  if (!fHistSlowComponent || cut != fSlowCutBin) {
+    fHistSlowComponent.reset(
+        fHist->ProjectionY(Form("HistSlowComponent%02d", fIndex), cut));
+    fHistSlowComponent->SetDirectory(nullptr);
+    fSlowCutBin = cut;
+  }
+
+  double peak, sigma;
+  if (fFastMode)
+    FitSlowComponentFast(peak, sigma);
+  else
+    FitSlowComponent(peak, sigma);
+  fPSPeak = peak;
+  fPSSigma = sigma;
 
+  auto startBin = fHist->GetYaxis()->FindBin(peak - 3 * sigma);
+  auto endBin = fHist->GetYaxis()->FindBin(peak + 3 * sigma);
+
+  if (!fHistResult || startBin != fResultStartBin ||
+      endBin != fResultEndBin) {
+    fHistResult.reset(
+        fHist->ProjectionX(Form("HistResult%02d", fIndex), startBin, endBin));
+    fHistResult->SetDirectory(nullptr);
+    fResultStartBin = startBin;
+    fResultEndBin = endBin;
+  }
+
+  std::cout << fIndex << ":\t" << fHistResult->FindBin(fTimeTh) << "\t"
+            << fHistResult->GetNbinsX() << "\n"
+            << std::flush;
+  fHistResult->GetXaxis()->SetRange(fHistResult->FindBin(fTimeTh),
+                                    fHistResult->GetNbinsX());
+  fPulseShapeTh = fHistPS->GetBinCenter(endBin);
+}
+
+YieldCut_t TAsymmetry::GetYieldCut() const
+{
+  YieldCut_t cut{false, 0., 0., 0., 0.};
+  if (fYieldStartBin < 0) return cut;
+
+  // Under and overflow bins have no edge
+  auto lowEdge = [](const TAxis *axis, int bin) {
+    return (bin < 1) ? -HUGE_VAL : axis->GetBinLowEdge(bin);
+  };
+  auto upEdge = [](const TAxis *axis, int bin) {
+    return (bin > axis->GetNbins()) ? HUGE_VAL : axis->GetBinUpEdge(bin);
+  };
+  auto xAxis = fHist->GetXaxis();
+  auto yAxis = fHist->GetYaxis();
+  cut.valid = true;
+  cut.tofMin = lowEdge(xAxis, fYieldStartBin);
+  cut.tofMax = upEdge(xAxis, fYieldStopBin);
+  cut.psMin = lowEdge(yAxis, fResultStartBin);
+  cut.psMax = upEdge(yAxis, fResultEndBin);
+
+  return cut;
+}
+
+void TAsymmetry::FitSlowComponent(double &peak, double &sigma)
+{
   TSpectrum s(4);
   s.Search(fHistSlowComponent.get(), 3, "goff", 0.005);
   auto nPeaks = s.GetNPeaks();
-  auto peak = fHistSlowComponent->GetBinCenter(fHistSlowComponent->GetNbinsX());
-  auto sigma = 0.02;
+  peak = fHistSlowComponent->GetBinCenter(fHistSlowComponent->GetNbinsX());
+  sigma = 0.02;
+  // Planes are analysed in parallel.  One output for one plane
+  std::ostringstream log;
+  log << fIndex << ":\t";
   for (auto i = 0; i < nPeaks; i++) {
     auto pos = s.GetPositionX()[i];
     if (peak > pos) peak = pos;
-    std::cout << pos << "\t";
+    log << pos << "\t";
   }
-  std::cout << std::endl;
+  log << "\n";
+  std::cout << log.str() << std::flush;
 
   fFitFnc.reset(
       new TF1(Form("f%02d", fIndex), "gaus", peak - sigma, peak + sigma));
@@ -251,26 +438,126 @@ void TAsymmetry::PulseShapeCutLast()
 
   peak = fFitFnc->GetParameter(1);
   sigma = fFitFnc->GetParameter(2);
-  auto startBin = fHist->GetYaxis()->FindBin(peak - 3 * sigma);
-  auto endBin = fHist->GetYaxis()->FindBin(peak + 3 * sigma);
+}
 
-  fHistResult.reset(
-      fHist->ProjectionX(Form("HistResult%02d", fIndex), startBin, endBin));
-  fHistResult->SetDirectory(nullptr);
+void TAsymmetry::FitSlowComponentFast(double &peak, double &sigma)
+{
+  // Same parameters as FitSlowComponent().  At most 4 highest peaks of the
+  // smoothed histogram above the threshold, and the lowest PS one is taken.
+  constexpr auto peakSigma = 3.;  // bins
+  constexpr auto peakTh = 0.005;
+  constexpr auto maxPeaks = 4u;
+  const auto nBins = fHistSlowComponent->GetNbinsX();
+  auto smoothed = Smooth(fHistSlowComponent.get(), 1, nBins, peakSigma);
+  const auto max = *std::max_element(smoothed.begin(), smoothed.end());
+
+  // Local maximum in +- 3 sigma
+  const auto halfWidth = int(3 * peakSigma);
+  std::vector<std::pair<double, int>> peaks;  // height, index
+  for (auto i = 1; i < nBins - 1; i++) {
+    if (smoothed[i] <= max * peakTh) continue;
+    auto isPeak = true;
+    for (auto j = std::max(0, i - halfWidth);
+         j <= std::min(nBins - 1, i + halfWidth) && isPeak; j++) {
+      if (j < i) isPeak = smoothed[j] < smoothed[i];
+      if (j > i) isPeak = smoothed[j] <= smoothed[i];
+    }
+    if (isPeak) peaks.push_back(std::make_pair(smoothed[i], i));
+  }
+  std::sort(peaks.rbegin(), peaks.rend());
+  if (peaks.size() > maxPeaks) peaks.resize(maxPeaks);
+
+  peak = fHistSlowComponent->GetBinCenter(nBins);
+  for (auto &&p : peaks)
+    peak = std::min(peak, fHistSlowComponent->GetBinCenter(p.second + 1));
+
+  // Two steps as FitSlowComponent().  Kept when the fit fails
+  sigma = 0.02;
+  double mean, width;
+  for (auto i = 0; i < 2; i++) {
+    if (FitLogParabola(fHistSlowComponent.get(), peak - sigma, peak + sigma,
+                       mean, width)) {
+      peak = mean;
+      sigma = width;
+    }
+  }
+}
 
-  std::cout << fHistResult->FindBin(fTimeTh) << "\t" << fHistResult->GetNbinsX()
-            << std::endl;
-  fHistResult->GetXaxis()->SetRange(fHistResult->FindBin(fTimeTh),
-                                    fHistResult->GetNbinsX());
-  fPulseShapeTh = fHistPS->GetBinCenter(endBin);
+double TAsymmetry::FindTOFPeak()
+{
+  fSpectrum->Search(fHistResult.get(), 2, "goff", fSpectrumTh);
+  return fSpectrum->GetPositionX()[0];
+}
+
+double TAsymmetry::FindTOFPeakFast()
+{
+  // Highest bin of the smoothed histogram in the axis range set by
+  // PulseShapeCutLast(), same range as TSpectrum::Search() uses
+  const auto first = fHistResult->GetXaxis()->GetFirst();
+  const auto last = fHistResult->GetXaxis()->GetLast();
+  auto smoothed = Smooth(fHistResult.get(), first, last, 2.);
+  const auto maxIndex =
+      std::max_element(smoothed.begin(), smoothed.end()) - smoothed.begin();
+  return fHistResult->GetBinCenter(first + maxIndex);
+}
+
+void TAsymmetry::CheckFastMode()
+{
+  if (!fHistSlowComponent || !fHistResult) return;
+
+  const auto start = std::chrono::steady_clock::now();
+  double peak, sigma;
+  FitSlowComponent(peak, sigma);
+  const auto tofPeak = FindTOFPeak();
+  const auto middle = std::chrono::steady_clock::now();
+  double fastPeak, fastSigma;
+  FitSlowComponentFast(fastPeak, fastSigma);
+  const auto fastTOFPeak = FindTOFPeakFast();
+  const auto stop = std::chrono::steady_clock::now();
+
+  // Same area as Integral() with the cuts of each way
+  auto yield = [this](double psPeak, double psSigma, double timePeak) {
+    auto xAxis = fHist->GetXaxis();
+    auto yAxis = fHist->GetYaxis();
+    return fHist->Integral(xAxis->FindBin(timePeak - fTimeWindow / 2.),
+                           xAxis->FindBin(timePeak + fTimeWindow / 2.),
+                           yAxis->FindBin(psPeak - 3 * psSigma),
+                           yAxis->FindBin(psPeak + 3 * psSigma));
+  };
+  const auto refYield = yield(peak, sigma, tofPeak);
+  const auto fastYield = yield(fastPeak, fastSigma, fastTOFPeak);
+
+  using us = std::chrono::duration<double, std::micro>;
+  std::ostringstream log;
+  log << "Fast mode check " << fIndex << ":\t"
+      << "PS peak " << peak << " / " << fastPeak << "\t"
+      << "sigma " << sigma << " / " << fastSigma << "\t"
+      << "TOF peak " << tofPeak << " / " << fastTOFPeak << "\t"
+      << "Yield " << refYield << " / " << fastYield << " ("
+      << (refYield > 0. ? (fastYield - refYield) / refYield : 0.) << ")\t"
+      << "Time " << us(middle - start).count() << " / "
+      << us(stop - middle).count() << " us\n";
+  std::cout << log.str() << std::flush;
 }
 
 double TAsymmetry::Integral()
 {
-  fSpectrum->Search(fHistResult.get(), 2, "goff", fSpectrumTh);
-  const auto peak = fSpectrum->GetPositionX()[0];
+  fTOFPeak = fFastMode ? FindTOFPeakFast() : FindTOFPeak();
+  const auto peak = fTOFPeak;
   const auto startBin = fHistResult->FindBin(peak - fTimeWindow / 2.);
   const auto stopBin = fHistResult->FindBin(peak + fTimeWindow / 2.);
+  fYieldStartBin = startBin;
+  fYieldStopBin = stopBin;
 
   return fHistResult->Integral(startBin, stopBin);
 }
+
+double TAsymmetry::GetYield(const THistRing &ring, uint32_t nSlices) const
+{
+  if (fYieldStartBin < 0) return 0.;
+
+  // Same area as Integral(): TOF bins of the time window and PS bins of
+  // fHistResult
+  return ring.Integral(nSlices, fYieldStartBin, fYieldStopBin,
+                       fResultStartBin, fResultEndBin);
+}
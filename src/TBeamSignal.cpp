@@ -1,6 +1,10 @@
+#include <algorithm>
+#include <cmath>
+
 #include <TH1.h>
 
 #include "TBeamSignal.hpp"
+#include "TSignalKernel.hpp"
 
 TBeamSignal::TBeamSignal() : TSignal() {}
 
@@ -8,33 +12,67 @@ TBeamSignal::~TBeamSignal() {}
 
 TBeamSignal::TBeamSignal(std::vector<short> *signal) : TSignal()
 {
-  SetSignal(signal);
+  if (signal) SetSignal(signal);
 }
 
-void TBeamSignal::SetSignal(std::vector<short> *signal)
+void TBeamSignal::SetSignal(const short *signal, uint32_t size)
 {
   fSignal = signal;
+  fSize = size;
   // SetThreshold();
 }
 
 void TBeamSignal::SetThreshold()
 {
-  double min = *std::min_element(fSignal->begin(), fSignal->end());
-  double max = *std::max_element(fSignal->begin(), fSignal->end());
+  double min = *std::min_element(fSignal, fSignal + fSize);
+  double max = *std::max_element(fSignal, fSignal + fSize);
   fThreshold = (min + max) / 2.;
 }
 
+void TBeamSignal::ProcessSignal() { fTrgTime = FindTrgTime(fSignal, fSize); }
+
+void TBeamSignal::ProcessBatch(const short *data, uint32_t nWaveforms,
+                               uint32_t recordLength,
+                               std::vector<double> &trgTime)
+{
+  if (trgTime.size() < nWaveforms) trgTime.resize(nWaveforms);
+  for (uint32_t i = 0; i < nWaveforms; i++) {
+    trgTime[i] =
+        FindTrgTime(data + std::size_t(i) * recordLength, recordLength);
+  }
+}
+
+double TBeamSignal::FindTrgTime(const short *signal, int size)
+{
+  // Same as CalTrgTime() with the vectorized loops
+  short min, max;
+  TSignalKernel::MinMax(signal, size, min, max);
+  if (min == max) return 0.;  // Flat, no beam trigger
+  const auto th = (double(min) + double(max)) / 2.;
+
+  const auto i = TSignalKernel::FindCrossing(signal, size, std::ceil(th),
+                                             std::floor(th));
+  if (i < 0 || signal[i + 1] == signal[i]) return 0.;  // Not 0 / 0
+
+  auto dx = 1.;
+  auto dy = double(signal[i + 1] - signal[i]);
+  auto diff = double(th - signal[i]);
+  return i + diff * dx / dy;
+}
+
 void TBeamSignal::CalTrgTime()
 {
   fTrgTime = 0.;
   SetThreshold();
 
-  const auto searchSize = fSignal->size() - 1;
+  const auto searchSize = fSize - 1;
   for (unsigned int i = 0; i < searchSize; i++) {
-    if ((*fSignal)[i] >= fThreshold && (*fSignal)[i + 1] <= fThreshold) {
+    if (fSignal[i] >= fThreshold && fSignal[i + 1] <= fThreshold) {
+      // Flat waveform or both samples on the threshold.  Not 0 / 0
+      if (fSignal[i + 1] == fSignal[i]) break;
       auto dx = 1.;
-      auto dy = double((*fSignal)[i + 1] - (*fSignal)[i]);
-      auto diff = double(fThreshold - (*fSignal)[i]);
+      auto dy = double(fSignal[i + 1] - fSignal[i]);
+      auto diff = double(fThreshold - fSignal[i]);
       fTrgTime = i + diff * dx / dy;
       break;
     }
@@ -56,9 +94,8 @@ void TBeamSignal::Plot()
   }
 
   fGraph->Clear();
-  auto size = fSignal->size();
-  for (unsigned int i = 0; i < size; i++) {
-    fGraph->SetPoint(i, i, (*fSignal)[i]);
+  for (unsigned int i = 0; i < fSize; i++) {
+    fGraph->SetPoint(i, i, fSignal[i]);
   }
 
   fCanvas->cd();
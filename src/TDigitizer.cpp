@@ -234,7 +234,7 @@ CAEN_DGTZ_ErrorCode TDigitizer::RegisterSetBits(uint16_t addr, int start_bit,
                                                 int end_bit, int val)
 {  // copy from digiTes
   uint32_t mask = 0, reg;
-  int ret;
+  int ret = 0;
   int i;
 
   if (((addr & 0xFF00) == 0x8000) && (addr != 0x8000) && (addr != 0x8004) &&
@@ -0,0 +1,218 @@
+#include <unistd.h>
+
+#include <algorithm>
+#include <chrono>
+
+#include "TEventProcessor.hpp"
+
+namespace
+{
+constexpr uint32_t kIdleEpoch = 0xFFFFFFFF;
+}
+
+TEventProcessor::TEventProcessor(uint32_t id, uint32_t queueSize,
+                                 const TWaveBlock &prototype,
+                                 const TH2D *hisTemplate)
+    : fID(id),
+      fThreshold(500.),
+      fCFDThreshold(0.),
+      fShortGate(30),
+      fLongGate(300),
+      fParVersion(0),
+      fWorkerParVersion(0),
+      fEpoch(0),
+      fFillEpoch(kIdleEpoch),
+      fCutVersion(0),
+      fWorkerCutVersion(0),
+      fRunning(false),
+      fProcessCounter(0)
+{
+  fQueue.reset(new TRingBuffer<TWaveBlock>(queueSize, prototype));
+
+  for (auto i = 0; i < 3; i++) {
+    fCuts[i] = fWorkerCuts[i] = YieldCut_t{false, 0., 0., 0., 0.};
+    fStreamYield[i] = 0;
+  }
+
+  fInSignal.reset(new TSignal());
+  fOutSignal1.reset(new TSignal());
+  fOutSignal2.reset(new TSignal());
+  fBeam.reset(new TBeamSignal());
+
+  for (auto &&hists : fHists) {
+    for (auto &&hist : hists) hist.reset(new TFastHist2D(hisTemplate));
+  }
+
+  const auto nEvents = prototype.GetMaxEvents();
+  fBeamTrg.resize(nEvents);
+  for (auto i = 0; i < 3; i++) {
+    fResult[i].Resize(nEvents);
+    fTOF[i].resize(nEvents);
+    fPS[i].resize(nEvents);
+  }
+}
+
+TEventProcessor::~TEventProcessor() { Stop(); }
+
+void TEventProcessor::SetSignalParameters(double th, double cfd, int shortGate,
+                                          int longGate)
+{
+  std::lock_guard<std::mutex> lock(fParMutex);
+  fThreshold = th;
+  fCFDThreshold = cfd;
+  fShortGate = shortGate;
+  fLongGate = longGate;
+  fParVersion++;
+}
+
+void TEventProcessor::ApplySignalParameters()
+{
+  std::lock_guard<std::mutex> lock(fParMutex);
+  TSignal *signals[3]{fInSignal.get(), fOutSignal1.get(), fOutSignal2.get()};
+  for (auto signal : signals) {
+    signal->SetThreshold(fThreshold);
+    signal->SetCFDThreshold(fCFDThreshold);
+    signal->SetShortGate(fShortGate);
+    signal->SetLongGate(fLongGate);
+  }
+  fWorkerParVersion = fParVersion.load();
+}
+
+void TEventProcessor::Start()
+{
+  fRunning = true;
+  fThread = std::thread(&TEventProcessor::Loop, this);
+}
+
+void TEventProcessor::Stop()
+{
+  fRunning = false;
+  if (fThread.joinable()) fThread.join();
+}
+
+void TEventProcessor::Loop()
+{
+  while (fRunning) {
+    while (auto block = fQueue->GetReadSlot()) {
+      if (fParVersion.load() != fWorkerParVersion) ApplySignalParameters();
+      const auto start = std::chrono::steady_clock::now();
+      ProcessBlock(*block);
+      const std::chrono::duration<double> elapsed =
+          std::chrono::steady_clock::now() - start;
+      // One observation for each event, with the mean of the batch
+      const auto nEvents = block->GetNEvents();
+      if (nEvents > 0)
+        fEventLatency.Observe(elapsed.count() / nEvents, nEvents);
+
+      // The batch is finished.  The slot can be reused by the producer
+      fProcessCounter += block->GetNEvents();
+      fQueue->Pop();
+    }
+
+    usleep(1000);
+  }
+}
+
+void TEventProcessor::ProcessBlock(const TWaveBlock &block)
+{
+  const auto nEvents = block.GetNEvents();
+  const auto length = block.GetRecordLength();
+
+  TSignal *signals[3]{fInSignal.get(), fOutSignal1.get(), fOutSignal2.get()};
+  TWaveBlock::Channel_t chs[3]{TWaveBlock::kIn, TWaveBlock::kOut1,
+                               TWaveBlock::kOut2};
+
+  // Whole channel of the block at once
+  fBeam->ProcessBatch(block.GetChannel(TWaveBlock::kBeam), nEvents, length,
+                      fBeamTrg);
+  for (auto i = 0; i < 3; i++) {
+    signals[i]->ProcessBatch(block.GetChannel(chs[i]), nEvents, length,
+                             fResult[i]);
+
+    const auto &result = fResult[i];
+    for (uint32_t iEve = 0; iEve < nEvents; iEve++) {
+      fPS[i][iEve] = result.shortCharge[iEve] / result.longCharge[iEve];
+      fTOF[i][iEve] = CalTOF(i, result.trgTime[iEve], fBeamTrg[iEve]);
+    }
+  }
+
+  CountYields(nEvents);
+
+  // The set of histograms is decided once for one batch.
+  // Checking the epoch again after announcing it.  If MergeHists() switched
+  // it in between, the new one is used.
+  uint32_t epoch;
+  do {
+    epoch = fEpoch.load();
+    fFillEpoch.store(epoch);
+  } while (epoch != fEpoch.load());
+
+  auto &hists = fHists[epoch & 1];
+  for (auto i = 0; i < 3; i++) {
+    for (uint32_t iEve = 0; iEve < nEvents; iEve++) {
+      if (fTOF[i][iEve] > 0.) hists[i]->Fill(fTOF[i][iEve], fPS[i][iEve]);
+    }
+  }
+
+  fFillEpoch.store(kIdleEpoch);
+}
+
+void TEventProcessor::MergeHists(TFastHist2D *hisIn, TFastHist2D *hisOut1,
+                                 TFastHist2D *hisOut2)
+{
+  // Switching the worker to the other set.
+  // Only the batch being filled now can use the old set.  Waiting for it.
+  const auto epoch = fEpoch.fetch_add(1);
+  while (fFillEpoch.load() == epoch) std::this_thread::yield();
+
+  // Nobody touches the old set until the next switch
+  auto &hists = fHists[epoch & 1];
+  hisIn->Add(*hists[0]);
+  hisOut1->Add(*hists[1]);
+  hisOut2->Add(*hists[2]);
+  for (auto &&hist : hists) hist->Reset();
+}
+
+void TEventProcessor::SetYieldCuts(const YieldCut_t &cutIn,
+                                   const YieldCut_t &cutOut1,
+                                   const YieldCut_t &cutOut2)
+{
+  std::lock_guard<std::mutex> lock(fCutMutex);
+  fCuts[0] = cutIn;
+  fCuts[1] = cutOut1;
+  fCuts[2] = cutOut2;
+  for (auto &&yield : fStreamYield) yield = 0;
+  fCutVersion++;
+}
+
+void TEventProcessor::CountYields(uint32_t nEvents)
+{
+  if (fCutVersion.load() != fWorkerCutVersion) {
+    std::lock_guard<std::mutex> lock(fCutMutex);
+    std::copy(fCuts, fCuts + 3, fWorkerCuts);
+    fWorkerCutVersion = fCutVersion.load();
+  }
+
+  uint64_t n[3]{0, 0, 0};
+  for (auto i = 0; i < 3; i++) {
+    const auto &cut = fWorkerCuts[i];
+    if (!cut.valid) continue;
+
+    // Same condition as the histogram filling
+    for (uint32_t iEve = 0; iEve < nEvents; iEve++) {
+      const auto tof = fTOF[i][iEve];
+      const auto ps = fPS[i][iEve];
+      if (tof > 0. && tof >= cut.tofMin && tof < cut.tofMax &&
+          ps >= cut.psMin && ps < cut.psMax)
+        n[i]++;
+    }
+  }
+  if (n[0] == 0 && n[1] == 0 && n[2] == 0) return;
+
+  // Counted by the old cuts, if the cuts were changed during the batch.
+  // Checked and added under the lock: SetYieldCuts() can not reset the
+  // counters in between
+  std::lock_guard<std::mutex> lock(fCutMutex);
+  if (fCutVersion.load() != fWorkerCutVersion) return;
+  for (auto i = 0; i < 3; i++) fStreamYield[i] += n[i];
+}
@@ -0,0 +1,70 @@
+#include <algorithm>
+
+#include <TAxis.h>
+
+#include "TFastHist2D.hpp"
+
+TFastHist2D::TFastHist2D(int nBinsX, double xMin, double xMax, int nBinsY,
+                         double yMin, double yMax)
+{
+  SetBinning(nBinsX, xMin, xMax, nBinsY, yMin, yMax);
+}
+
+TFastHist2D::TFastHist2D(const TH2 *hist)
+{
+  auto xAxis = hist->GetXaxis();
+  auto yAxis = hist->GetYaxis();
+  SetBinning(xAxis->GetNbins(), xAxis->GetXmin(), xAxis->GetXmax(),
+             yAxis->GetNbins(), yAxis->GetXmin(), yAxis->GetXmax());
+}
+
+void TFastHist2D::SetBinning(int nBinsX, double xMin, double xMax, int nBinsY,
+                             double yMin, double yMax)
+{
+  fNBinsX = nBinsX;
+  fXMin = xMin;
+  fXMax = xMax;
+  fXRange = xMax - xMin;
+  fNBinsY = nBinsY;
+  fYMin = yMin;
+  fYMax = yMax;
+  fYRange = yMax - yMin;
+
+  fNCellsX = fNBinsX + 2;
+  fCounts.assign(std::size_t(fNCellsX) * (fNBinsY + 2), 0);
+  fFilledBins.clear();
+  fEntries = 0;
+}
+
+void TFastHist2D::Reset()
+{
+  // Clearing whole is faster when many bins are filled
+  if (fFilledBins.size() > fCounts.size() / 8) {
+    std::fill(fCounts.begin(), fCounts.end(), 0);
+  } else {
+    for (auto bin : fFilledBins) fCounts[bin] = 0;
+  }
+  fFilledBins.clear();
+  fEntries = 0;
+}
+
+void TFastHist2D::Add(const TFastHist2D &hist)
+{
+  for (auto bin : hist.fFilledBins) {
+    if (fCounts[bin] == 0) fFilledBins.push_back(bin);
+    fCounts[bin] += hist.fCounts[bin];
+  }
+  fEntries += hist.fEntries;
+}
+
+void TFastHist2D::AddTo(TH2 *hist) const
+{
+  if (fEntries == 0) return;
+
+  // Global bin of TH2 is same as ours
+  for (auto bin : fFilledBins) hist->AddBinContent(bin, fCounts[bin]);
+
+  // AddBinContent does not touch the statistics.  The sum of weights stays
+  // 0, and then TH1::GetStats() calculates them from bins when needed.
+  hist->SetEntries(hist->GetEntries() + fEntries);
+}
@@ -0,0 +1,49 @@
+#include "TFixedSignal.hpp"
+
+namespace
+{
+struct FixedSignalEntry_t {
+  int recordLength;
+  int rewind;
+  int shortGate;
+  int longGate;
+  FixedBatchFunc_t func;
+};
+
+// Our configurations.  The record length is always 256, and the gates are
+// taken from the PolMeterPar DB.  Add here for a new gate setting.
+const FixedSignalEntry_t kFixedSignals[]{
+    {256, 5, 20, 100, &TFixedSignal<256, 5, 20, 100>::ProcessBatch},
+    {256, 5, 20, 150, &TFixedSignal<256, 5, 20, 150>::ProcessBatch},
+    {256, 5, 20, 200, &TFixedSignal<256, 5, 20, 200>::ProcessBatch},
+    {256, 5, 20, 300, &TFixedSignal<256, 5, 20, 300>::ProcessBatch},
+    {256, 5, 25, 100, &TFixedSignal<256, 5, 25, 100>::ProcessBatch},
+    {256, 5, 25, 150, &TFixedSignal<256, 5, 25, 150>::ProcessBatch},
+    {256, 5, 25, 200, &TFixedSignal<256, 5, 25, 200>::ProcessBatch},
+    {256, 5, 25, 300, &TFixedSignal<256, 5, 25, 300>::ProcessBatch},
+    {256, 5, 30, 100, &TFixedSignal<256, 5, 30, 100>::ProcessBatch},
+    {256, 5, 30, 150, &TFixedSignal<256, 5, 30, 150>::ProcessBatch},
+    {256, 5, 30, 200, &TFixedSignal<256, 5, 30, 200>::ProcessBatch},
+    {256, 5, 30, 300, &TFixedSignal<256, 5, 30, 300>::ProcessBatch},
+    {256, 5, 40, 100, &TFixedSignal<256, 5, 40, 100>::ProcessBatch},
+    {256, 5, 40, 150, &TFixedSignal<256, 5, 40, 150>::ProcessBatch},
+    {256, 5, 40, 200, &TFixedSignal<256, 5, 40, 200>::ProcessBatch},
+    {256, 5, 40, 300, &TFixedSignal<256, 5, 40, 300>::ProcessBatch},
+    {256, 5, 50, 100, &TFixedSignal<256, 5, 50, 100>::ProcessBatch},
+    {256, 5, 50, 150, &TFixedSignal<256, 5, 50, 150>::ProcessBatch},
+    {256, 5, 50, 200, &TFixedSignal<256, 5, 50, 200>::ProcessBatch},
+    {256, 5, 50, 300, &TFixedSignal<256, 5, 50, 300>::ProcessBatch},
+};
+}  // namespace
+
+FixedBatchFunc_t TFixedSignalList::Find(int recordLength, int rewind,
+                                        int shortGate, int longGate)
+{
+  for (auto &&entry : kFixedSignals) {
+    if (entry.recordLength == recordLength && entry.rewind == rewind &&
+        entry.shortGate == shortGate && entry.longGate == longGate)
+      return entry.func;
+  }
+
+  return nullptr;
+}
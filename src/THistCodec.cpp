@@ -0,0 +1,79 @@
+#include <algorithm>
+#include <cmath>
+
+#include <TAxis.h>
+
+#include "THistCodec.hpp"
+
+uint32_t THistCodec::Encode(const TH2 *hist, std::vector<uint8_t> &buf)
+{
+  buf.clear();
+  const int nCells = (hist->GetXaxis()->GetNbins() + 2) *
+                     (hist->GetYaxis()->GetNbins() + 2);
+
+  uint32_t nBins = 0;
+  int lastBin = 0;
+  for (auto bin = 0; bin < nCells; bin++) {
+    const auto content = hist->GetBinContent(bin);
+    if (!(content > 0.)) continue;
+
+    PutVarint(bin - lastBin, buf);
+    PutVarint(std::llround(content), buf);
+    lastBin = bin;
+    nBins++;
+  }
+
+  return nBins;
+}
+
+uint32_t THistCodec::Encode(const TFastHist2D &hist, std::vector<uint8_t> &buf)
+{
+  buf.clear();
+  // Filled bins are in the filled order.  Steps need the ascending order
+  auto bins = hist.GetFilledBins();
+  std::sort(bins.begin(), bins.end());
+
+  int lastBin = 0;
+  for (auto bin : bins) {
+    PutVarint(bin - lastBin, buf);
+    PutVarint(hist.GetBinContent(bin), buf);
+    lastBin = bin;
+  }
+
+  return bins.size();
+}
+
+bool THistCodec::Decode(const uint8_t *data, std::size_t size, TH2 *hist)
+{
+  const int nCells = (hist->GetXaxis()->GetNbins() + 2) *
+                     (hist->GetYaxis()->GetNbins() + 2);
+  const auto end = data + size;
+
+  uint64_t bin = 0;
+  double entries = hist->GetEntries();
+  while (data < end) {
+    uint64_t step, count;
+    if (!GetVarint(data, end, step) || !GetVarint(data, end, count))
+      return false;
+    bin += step;
+    if (bin >= uint64_t(nCells)) return false;
+
+    hist->AddBinContent(bin, count);
+    entries += count;
+  }
+  hist->SetEntries(entries);
+
+  return true;
+}
+
+bool THistCodec::GetVarint(const uint8_t *&data, const uint8_t *end,
+                           uint64_t &val)
+{
+  val = 0;
+  for (auto shift = 0; shift < 64 && data < end; shift += 7) {
+    const auto byte = *data++;
+    val |= uint64_t(byte & 0x7F) << shift;
+    if ((byte & 0x80) == 0) return true;
+  }
+  return false;
+}
@@ -0,0 +1,61 @@
+#include "THistRing.hpp"
+
+THistRing::THistRing(uint32_t depth) : fHead(0), fNSlices(0)
+{
+  if (depth == 0) depth = 1;
+  fSlices.resize(depth);
+  Clear();
+}
+
+void THistRing::Clear()
+{
+  for (auto &&slice : fSlices) {
+    slice.bins.clear();
+    slice.entries = 0;
+  }
+  fHead = 0;
+  fNSlices = 0;
+}
+
+void THistRing::AddSlice(const TFastHist2D &hist)
+{
+  // clear() keeps the capacity.  No allocation after the ring is warmed up
+  auto &slice = fSlices[fHead];
+  slice.bins.clear();
+  for (auto bin : hist.GetFilledBins()) {
+    int binX, binY;
+    hist.GetBinXY(bin, binX, binY);
+    slice.bins.push_back(
+        {uint16_t(binX), uint16_t(binY), hist.GetBinContent(bin)});
+  }
+  slice.entries = hist.GetEntries();
+
+  fHead = (fHead + 1) % fSlices.size();
+  if (fNSlices < fSlices.size()) fNSlices++;
+}
+
+uint64_t THistRing::Integral(uint32_t nSlices, int x1, int x2, int y1,
+                             int y2) const
+{
+  if (nSlices == 0 || nSlices > fNSlices) nSlices = fNSlices;
+
+  uint64_t sum = 0;
+  for (uint32_t i = 0; i < nSlices; i++) {
+    for (auto &&bin : GetSlice(i).bins) {
+      if (bin.x >= x1 && bin.x <= x2 && bin.y >= y1 && bin.y <= y2)
+        sum += bin.count;
+    }
+  }
+
+  return sum;
+}
+
+uint64_t THistRing::GetEntries(uint32_t nSlices) const
+{
+  if (nSlices == 0 || nSlices > fNSlices) nSlices = fNSlices;
+
+  uint64_t sum = 0;
+  for (uint32_t i = 0; i < nSlices; i++) sum += GetSlice(i).entries;
+
+  return sum;
+}
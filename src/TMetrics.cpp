@@ -0,0 +1,95 @@
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+
+#include "TMetrics.hpp"
+
+TLatencyHist::TLatencyHist() : fSum(0.)
+{
+  for (auto &&count : fCounts) count = 0;
+}
+
+void TLatencyHist::Observe(double sec, uint64_t n)
+{
+  int bin = 0;
+  if (sec > 1.e-6) bin = int(std::ceil(std::log2(sec * 1.e6)));
+  if (bin >= LatencyStat_t::kNBuckets) bin = LatencyStat_t::kNBuckets - 1;
+
+  const auto order = std::memory_order_relaxed;
+  fCounts[bin].store(fCounts[bin].load(order) + n, order);
+  fSum.store(fSum.load(order) + sec * n, order);
+}
+
+void TLatencyHist::AddTo(LatencyStat_t &stat) const
+{
+  for (auto i = 0; i < LatencyStat_t::kNBuckets; i++)
+    stat.counts[i] += fCounts[i].load(std::memory_order_relaxed);
+  stat.sum += fSum.load(std::memory_order_relaxed);
+}
+
+TMetrics::TMetrics(const std::string &fileName) : fFileName(fileName)
+{
+  // Counters are exact up to 1e15
+  fText.precision(15);
+}
+
+void TMetrics::Clear()
+{
+  fText.str("");
+  fText.clear();
+}
+
+void TMetrics::AddHeader(const char *name, const char *help,
+                         const char *type)
+{
+  fText << "# HELP " << name << " " << help << "\n"
+        << "# TYPE " << name << " " << type << "\n";
+}
+
+void TMetrics::AddCounter(const char *name, const char *help, double val)
+{
+  AddHeader(name, help, "counter");
+  fText << name << " " << val << "\n";
+}
+
+void TMetrics::AddGauge(const char *name, const char *help, double val)
+{
+  AddHeader(name, help, "gauge");
+  fText << name << " " << val << "\n";
+}
+
+void TMetrics::AddHistogram(const char *name, const char *help,
+                            const LatencyStat_t &stat)
+{
+  AddHeader(name, help, "histogram");
+  uint64_t cumulative = 0;
+  for (auto i = 0; i < LatencyStat_t::kNBuckets - 1; i++) {
+    cumulative += stat.counts[i];
+    fText << name << "_bucket{le=\"" << TLatencyHist::GetUpperBound(i)
+          << "\"} " << cumulative << "\n";
+  }
+  cumulative += stat.counts[LatencyStat_t::kNBuckets - 1];
+  fText << name << "_bucket{le=\"+Inf\"} " << cumulative << "\n"
+        << name << "_sum " << stat.sum << "\n"
+        << name << "_count " << cumulative << "\n";
+}
+
+bool TMetrics::Write()
+{
+  const auto tmpName = fFileName + ".tmp";
+  {
+    std::ofstream file(tmpName);
+    file << fText.str();
+    if (!file) {
+      std::cout << "Metrics can not be written to " << tmpName << std::endl;
+      return false;
+    }
+  }
+
+  if (std::rename(tmpName.c_str(), fFileName.c_str()) != 0) {
+    std::cout << "Metrics can not be written to " << fFileName << std::endl;
+    return false;
+  }
+  return true;
+}
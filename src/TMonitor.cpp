@@ -0,0 +1,217 @@
+#include <cmath>
+#include <iostream>
+#include <map>
+
+#include <THttpServer.h>
+
+#include "TMonitor.hpp"
+
+namespace
+{
+constexpr time_t kIdleTime = 60;  // No snapshot without requests [s]
+constexpr uint32_t kMaxCache = 64;
+constexpr uint32_t kMaxHistory = 2000;
+const char *kPlaneNames[3] = {"In", "Out1", "Out2"};
+
+double Asymmetry(double a, double b)
+{
+  return (a + b > 0.) ? fabs(a - b) / (a + b) : 0.;
+}
+}  // namespace
+
+// Response cache of THttpServer.  Cleared by each snapshot
+class TMonitorServer : public THttpServer
+{
+ public:
+  TMonitorServer(const char *engine, std::atomic<time_t> &lastRequest)
+      : THttpServer(engine), fLastRequest(lastRequest)
+  {
+  }
+
+  void ClearCache() { fCache.clear(); };
+
+ protected:
+  void ProcessRequest(std::shared_ptr<THttpCallArg> arg) override
+  {
+    fLastRequest = time(0);
+
+    const std::string key = std::string(arg->GetPathName()) + "/" +
+                            arg->GetFileName() + "?" + arg->GetQuery();
+    auto it = fCache.find(key);
+    if (it != fCache.end()) {
+      arg->SetContentType(it->second.contentType.c_str());
+      arg->SetZipping(it->second.zipping);
+      arg->SetContent(std::string(it->second.content));
+      return;
+    }
+
+    THttpServer::ProcessRequest(arg);
+    if (arg->Is404() || arg->IsPostponed() || fCache.size() >= kMaxCache)
+      return;
+    auto content = static_cast<const char *>(arg->GetContent());
+    fCache[key] = Response_t{arg->GetContentType(),
+                             std::string(content, arg->GetContentLength()),
+                             arg->GetZipping()};
+  };
+
+ private:
+  struct Response_t {
+    std::string contentType;
+    std::string content;
+    int zipping;
+  };
+  std::map<std::string, Response_t> fCache;
+  std::atomic<time_t> &fLastRequest;  // Of TMonitor
+};
+
+TMonitor::TMonitor(const std::string &engine)
+    : fEngine(engine),
+      fSnapshotTime(0),
+      fSnapshotInterval(0),
+      fNewSnapshot(false),
+      fHistsRegistered(false),
+      fLastRequest(0),
+      fServing(false),
+      fRequestPeriod(200),
+      fRunning(false)
+{
+  for (auto i = 0; i < 2; i++) {
+    fAsymmetry[i].reset(new TGraph());
+    const auto name = std::string("Asymmetry") + std::to_string(i + 1);
+    fAsymmetry[i]->SetNameTitle(name.c_str(),
+                                (name + ";Time [s];Asymmetry").c_str());
+  }
+}
+
+TMonitor::~TMonitor() { Stop(); }
+
+void TMonitor::Start()
+{
+  if (fThread.joinable()) return;
+  fRunning = true;
+  fThread = std::thread(&TMonitor::Loop, this);
+}
+
+void TMonitor::Stop()
+{
+  fRunning = false;
+  if (fThread.joinable()) fThread.join();
+}
+
+void TMonitor::Loop()
+{
+  // Made in this thread.  THttpServer processes the requests in the
+  // thread which made it
+  fServer.reset(new TMonitorServer(fEngine.c_str(), fLastRequest));
+  if (!fServer->IsAnyEngine()) {
+    std::cout << "HTTP monitor " << fEngine << " can not be started"
+              << std::endl;
+    fServer.reset();
+    return;
+  }
+  // Requests are processed only by this loop
+  fServer->SetTimer(0, kTRUE);
+  fServer->SetReadOnly(kTRUE);
+  for (auto &&graph : fAsymmetry) fServer->Register("/Results", graph.get());
+  {
+    // A snapshot taken before is shown too
+    std::lock_guard<std::mutex> lock(fMutex);
+    fHistsRegistered = false;
+    fNewSnapshot = fSnapshotTime != 0;
+  }
+  fServing = true;
+
+  while (fRunning) {
+    {
+      std::lock_guard<std::mutex> lock(fMutex);
+      if (fNewSnapshot) Publish();
+      fServer->ProcessRequests();
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(fRequestPeriod));
+  }
+
+  fServing = false;
+  fServer.reset();  // In this thread, before the registered objects
+}
+
+void TMonitor::Update(const TH2 *hists[3], const TAsymmetry *planes[3],
+                      const double yields[3])
+{
+  const auto now = time(0);
+  fHistory[0].push_back(now);
+  fHistory[1].push_back(Asymmetry(yields[0], yields[1]));
+  fHistory[2].push_back(Asymmetry(yields[0], yields[2]));
+  if (fHistory[0].size() > kMaxHistory) {
+    for (auto &&history : fHistory) history.pop_front();
+  }
+  if (!fServing) return;
+
+  // The first one is always made.  After that, only for the viewers
+  if (fSnapshotTime != 0 &&
+      (now - fSnapshotTime < time_t(fSnapshotInterval) ||
+       now - fLastRequest.load() > kIdleTime))
+    return;
+
+  // Serving now.  The next analysis makes it
+  std::unique_lock<std::mutex> lock(fMutex, std::try_to_lock);
+  if (!lock.owns_lock()) return;
+
+  fSnapshotTime = now;
+  TakeSnapshot(hists, planes, yields);
+  fNewSnapshot = true;
+}
+
+void TMonitor::TakeSnapshot(const TH2 *hists[3], const TAsymmetry *planes[3],
+                            const double yields[3])
+{
+  // Copies only.  The server is told by Publish() in the monitor thread
+  for (auto i = 0; i < 3; i++) {
+    if (!fHists[i]) {
+      fHists[i].reset(static_cast<TH2D *>(hists[i]->Clone()));
+      fHists[i]->SetDirectory(nullptr);
+    } else {
+      fHists[i]->Reset();
+      fHists[i]->Add(hists[i]);
+    }
+  }
+
+  const auto nPoints = fHistory[0].size();
+  for (auto i = 0; i < 2; i++) {
+    fAsymmetry[i]->Set(nPoints);
+    for (std::size_t p = 0; p < nPoints; p++)
+      fAsymmetry[i]->SetPoint(p, fHistory[0][p] - fHistory[0][0],
+                              fHistory[i + 1][p]);
+  }
+
+  fValues.clear();
+  for (auto i = 0; i < 3; i++) {
+    const std::string plane = kPlaneNames[i];
+    fValues.emplace_back(plane + "/Yield", yields[i]);
+    fValues.emplace_back(plane + "/TOFPeak", planes[i]->GetTOFPeak());
+    fValues.emplace_back(plane + "/PSPeak", planes[i]->GetPSPeak());
+    fValues.emplace_back(plane + "/PSSigma", planes[i]->GetPSSigma());
+  }
+  fValues.emplace_back("Asymmetry1", Asymmetry(yields[0], yields[1]));
+  fValues.emplace_back("Asymmetry2", Asymmetry(yields[0], yields[2]));
+  fValues.emplace_back("Time", fSnapshotTime);  // Of the snapshot
+}
+
+void TMonitor::Publish()
+{
+  // Monitor thread with fMutex
+  if (!fHistsRegistered && fHists[0]) {
+    for (auto &&hist : fHists) fServer->Register("/Planes", hist.get());
+    fHistsRegistered = true;
+  }
+
+  for (auto &&value : fValues) {
+    const auto path = "/Results/" + value.first;
+    fServer->CreateItem(path.c_str(), value.first.c_str());
+    fServer->SetItemField(path.c_str(), "_kind", "Text");
+    fServer->SetItemField(path.c_str(), "value",
+                          std::to_string(value.second).c_str());
+  }
+
+  fServer->ClearCache();
+  fNewSnapshot = false;
+}
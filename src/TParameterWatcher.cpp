@@ -0,0 +1,145 @@
+#include <chrono>
+#include <iostream>
+#include <stdexcept>
+
+#include <bsoncxx/builder/stream/document.hpp>
+#include <bsoncxx/json.hpp>
+#include <mongocxx/uri.hpp>
+using bsoncxx::builder::stream::document;
+using bsoncxx::builder::stream::finalize;
+
+#include "TParameterWatcher.hpp"
+
+namespace
+{
+// The fields were written as strings.  Numbers are also accepted.
+// false for a missing field
+bool GetNumber(const bsoncxx::document::view &doc, const char *key,
+               double &val)
+{
+  auto element = doc[key];
+  if (!element) return false;
+
+  switch (element.type()) {
+    case bsoncxx::type::k_utf8:
+      val = std::stod(element.get_utf8().value.to_string());
+      return true;
+    case bsoncxx::type::k_double:
+      val = element.get_double().value;
+      return true;
+    case bsoncxx::type::k_int32:
+      val = element.get_int32().value;
+      return true;
+    case bsoncxx::type::k_int64:
+      val = element.get_int64().value;
+      return true;
+    default:
+      throw std::invalid_argument(std::string("type of ") + key);
+  }
+}
+
+void Parse(const bsoncxx::document::view &doc, PolMeterPar_t &par)
+{
+  double val;
+  if (GetNumber(doc, "DCOffset", val)) par.board.DCOffset = val;
+  if (GetNumber(doc, "threshold", val)) par.board.th = val;
+  if (GetNumber(doc, "inCh", val)) par.board.inCh = val;
+  if (GetNumber(doc, "outCh1", val)) par.board.outCh1 = val;
+  if (GetNumber(doc, "outCh2", val)) par.board.outCh2 = val;
+  if (GetNumber(doc, "beamCh", val)) par.board.beamCh = val;
+  if (GetNumber(doc, "shortGate", val)) par.shortGate = val;
+  if (GetNumber(doc, "longGate", val)) par.longGate = val;
+  if (GetNumber(doc, "CFDThreshold", val)) par.CFDThreshold = val;
+}
+}  // namespace
+
+TParameterWatcher::TParameterWatcher(const std::string &uri)
+    : fURI(uri), fNewFlag(false), fRunning(false), fInterval(5)
+{
+}
+
+TParameterWatcher::~TParameterWatcher() { Stop(); }
+
+bool TParameterWatcher::Read(PolMeterPar_t &par)
+{
+  try {
+    if (!fClient) fClient.reset(new mongocxx::client(mongocxx::uri(fURI)));
+    auto collection = (*fClient)["GBS"]["PolMeterPar"];
+
+    // Only taking last data
+    auto opts = mongocxx::options::find{};
+    opts.limit(1);
+    auto order = document{} << "time" << -1 << finalize;
+    opts.sort(order.view());
+    auto cursor = collection.find({}, opts);
+    auto doc = cursor.begin();
+    if (doc == cursor.end()) {
+      std::cout << "No parameters in PolMeterPar" << std::endl;
+      return false;
+    }
+
+    auto json = bsoncxx::to_json(*doc);
+    if (json == fLastDocument) return true;
+    fLastDocument = json;  // A broken document is reported only once
+
+    // All fields are checked before changing par
+    auto newPar = par;
+    Parse(*doc, newPar);
+    par = newPar;
+  } catch (const std::exception &e) {
+    std::cout << "Reading PolMeterPar failed: " << e.what() << std::endl;
+    fClient.reset();
+    return false;
+  }
+
+  return true;
+}
+
+void TParameterWatcher::Start(const PolMeterPar_t &par)
+{
+  if (fThread.joinable()) return;
+  fPar = par;
+  fRunning = true;
+  fThread = std::thread(&TParameterWatcher::Loop, this);
+}
+
+void TParameterWatcher::Stop()
+{
+  {
+    std::lock_guard<std::mutex> lock(fMutex);
+    fRunning = false;
+  }
+  fCond.notify_all();
+  if (fThread.joinable()) fThread.join();
+}
+
+bool TParameterWatcher::GetNew(PolMeterPar_t &par)
+{
+  if (!fNewFlag) return false;
+
+  std::lock_guard<std::mutex> lock(fMutex);
+  par = fPar;
+  fNewFlag = false;
+  return true;
+}
+
+void TParameterWatcher::Loop()
+{
+  while (true) {
+    {
+      std::unique_lock<std::mutex> lock(fMutex);
+      fCond.wait_for(lock, std::chrono::seconds(fInterval),
+                     [this] { return !fRunning.load(); });
+      if (!fRunning) break;
+    }
+
+    // Only this thread writes fPar and fLastDocument after Start()
+    auto par = fPar;
+    const auto lastDocument = fLastDocument;
+    if (!Read(par) || fLastDocument == lastDocument) continue;
+
+    std::lock_guard<std::mutex> lock(fMutex);
+    fPar = par;
+    fNewFlag = true;
+  }
+}
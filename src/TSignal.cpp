@@ -1,10 +1,15 @@
+#include <algorithm>
+#include <cmath>
 #include <iostream>
 
 #include <TH1F.h>
 
+#include "TFixedSignal.hpp"
 #include "TSignal.hpp"
+#include "TSignalKernel.hpp"
 
 TSignal::TSignal()
+    : fSignal(nullptr), fSize(0), fFixedFunc(nullptr), fFixedLength(0)
 {
   fTrgTime = 0.;
   fShortCharge = 0.;
@@ -16,7 +21,7 @@ TSignal::TSignal(std::vector<short> *signal, double th, double cfd,
                  int shortGate, int longGate)
     : TSignal()
 {
-  fSignal = signal;
+  if (signal) SetSignal(signal);
   fThreshold = th;
   fCFDThreshold = cfd;
   fShortGate = shortGate;
@@ -56,9 +61,8 @@ void TSignal::Plot()
   }
 
   fGraph->Clear();
-  auto size = fSignal->size();
-  for (unsigned int i = 0; i < size; i++) {
-    fGraph->SetPoint(i, i, (*fSignal)[i]);
+  for (unsigned int i = 0; i < fSize; i++) {
+    fGraph->SetPoint(i, i, fSignal[i]);
   }
 
   fCanvas->cd();
@@ -71,7 +75,7 @@ void TSignal::Plot()
     SetPosition(fShortBox, start, min, start + fShortGate, max);
     SetPosition(fLongBox, start, min, start + fLongGate, max);
     SetPosition(fTriggerPos, fTrgTime, min, fTrgTime, max);
-    SetPosition(fBasePos, 0, fBaseLine, fSignal->size() - 1, fBaseLine);
+    SetPosition(fBasePos, 0, fBaseLine, fSize - 1, fBaseLine);
     fLongBox->Draw("SAME");
     fShortBox->Draw("SAME");
     fTriggerPos->Draw("SAME");
@@ -89,6 +93,92 @@ void TSignal::SetPosition(T &obj, double x1, double y1, double x2, double y2)
 }
 
 void TSignal::ProcessSignal()
+{
+  ProcessOne(fSignal, fSize, fBaseLine, fTrgTime, fShortCharge, fLongCharge,
+             fPulseHeight);
+}
+
+void TSignal::ProcessBatch(const short *data, uint32_t nWaveforms,
+                           uint32_t recordLength, SignalBatch_t &result)
+{
+  // Looking for the specialized one only when the setting is changed
+  if (fFixedLength != recordLength) {
+    fFixedFunc =
+        TFixedSignalList::Find(recordLength, fRewind, fShortGate, fLongGate);
+    fFixedLength = recordLength;
+  }
+  if (fFixedFunc) {
+    fFixedFunc(data, nWaveforms, fThreshold, fCFDThreshold, result);
+    return;
+  }
+
+  if (result.trgTime.size() < nWaveforms) result.Resize(nWaveforms);
+
+  double baseLine;
+  for (uint32_t i = 0; i < nWaveforms; i++) {
+    ProcessOne(data + std::size_t(i) * recordLength, recordLength, baseLine,
+               result.trgTime[i], result.shortCharge[i], result.longCharge[i],
+               result.pulseHeight[i]);
+  }
+}
+
+void TSignal::ProcessOne(const short *signal, int size, double &baseLine,
+                         double &trgTime, double &shortCharge,
+                         double &longCharge, double &pulseHeight) const
+{
+  // Two passes: baseline and minimum, then trigger and gates.
+  // Same as ProcessSignalScalar() except the last digits of the charges.
+  // The charges are calculated from the integer sums and exact, while the
+  // scalar loops accumulate the rounding error of double.
+  constexpr auto nBaseSamples = 40;
+  const auto nBase = std::min(nBaseSamples, size);
+  const auto baseSum = TSignalKernel::Sum(signal, 0, nBase);
+  baseLine = double(baseSum) / nBase;
+  const double min = TSignalKernel::Min(signal, size);
+
+  trgTime = 0.;
+  shortCharge = 0.;
+  longCharge = 0.;
+  pulseHeight = 0.;
+
+  if (fThreshold < baseLine - min) {
+    const auto th = baseLine - ((baseLine - min) * (fCFDThreshold / 100.));
+    // Comparing integer samples with double th
+    const auto i = TSignalKernel::FindCrossing(signal, size, std::ceil(th),
+                                               std::floor(th));
+    // Both samples on th (dy = 0) is no trigger, not 0 / 0
+    if (i >= 0 && signal[i + 1] != signal[i]) {
+      auto dx = 1.;
+      auto dy = double(signal[i + 1] - signal[i]);
+      auto diff = double(th - signal[i]);
+      trgTime = i + diff * dx / dy;
+    }
+  }
+
+  if (trgTime > 0.) {
+    auto start = int(trgTime) - fRewind;
+    if (start < 0) start = 0;
+    auto shortStop = std::max(start, std::min(start + fShortGate, size));
+    auto longStop = std::max(start, std::min(start + fLongGate, size));
+
+    // The shorter gate is a part of the longer gate
+    const auto first = std::min(shortStop, longStop);
+    const auto last = std::max(shortStop, longStop);
+    const auto firstSum = TSignalKernel::Sum(signal, start, first);
+    const auto lastSum = firstSum + TSignalKernel::Sum(signal, first, last);
+    const auto shortSum = (shortStop == first) ? firstSum : lastSum;
+    const auto longSum = (longStop == first) ? firstSum : lastSum;
+
+    // n * (baseSum / nBase) - sum
+    shortCharge =
+        double((shortStop - start) * baseSum - nBase * shortSum) / nBase;
+    longCharge = double((longStop - start) * baseSum - nBase * longSum) / nBase;
+
+    pulseHeight = baseLine - min;
+  }
+}
+
+void TSignal::ProcessSignalScalar()
 {
   CalBaseLine();
   CalTrgTime();
@@ -102,7 +192,7 @@ void TSignal::CalBaseLine()
   constexpr auto nSamples = 40;
   fBaseLine = 0.;
   for (auto i = 0; i < nSamples; i++) {
-    fBaseLine += (*fSignal)[i];
+    fBaseLine += fSignal[i];
   }
   fBaseLine /= nSamples;
 
@@ -112,7 +202,7 @@ void TSignal::CalBaseLine()
 void TSignal::CalTrgTime()
 {
   fTrgTime = 0.;
-  auto min = *std::min_element(fSignal->begin(), fSignal->end());
+  auto min = *std::min_element(fSignal, fSignal + fSize);
   if (fThreshold < fBaseLine - min) {
     // Simple
     // const auto th = fBaseLine - fThreshold;
@@ -120,14 +210,15 @@ void TSignal::CalTrgTime()
     // CFD
     const auto th = fBaseLine - ((fBaseLine - min) * (fCFDThreshold / 100.));
 
-    const auto searchSize = fSignal->size() - 1;
+    const auto searchSize = fSize - 1;
     for (unsigned int i = 0; i < searchSize; i++) {
       // std::cout << i <<"\t"<< fSignal[i] <<"\t"<< th <<"\t"<< fSignal[i + 1] <<
       // std::endl;
-      if ((*fSignal)[i] >= th && (*fSignal)[i + 1] <= th) {
+      if (fSignal[i] >= th && fSignal[i + 1] <= th) {
+        if (fSignal[i + 1] == fSignal[i]) break;  // No trigger, not 0 / 0
         auto dx = 1.;
-        auto dy = double((*fSignal)[i + 1] - (*fSignal)[i]);
-        auto diff = double(th - (*fSignal)[i]);
+        auto dy = double(fSignal[i + 1] - fSignal[i]);
+        auto diff = double(th - fSignal[i]);
         fTrgTime = i + diff * dx / dy;
         // std::cout << "hit\t" << fTrgTime << std::endl;
         break;
@@ -144,10 +235,10 @@ void TSignal::CalShortCharge()
     auto start = int(fTrgTime) - fRewind;
     if (start < 0) start = 0;
     auto stop = start + fShortGate;
-    if (stop > int(fSignal->size())) stop = fSignal->size();
+    if (stop > int(fSize)) stop = fSize;
 
     for (auto i = start; i < stop; i++) {
-      fShortCharge += fBaseLine - double((*fSignal)[i]);
+      fShortCharge += fBaseLine - double(fSignal[i]);
     }
     // std::cout << "short\t" << fShortCharge << std::endl;
   }
@@ -161,10 +252,10 @@ void TSignal::CalLongCharge()
     auto start = int(fTrgTime) - fRewind;
     if (start < 0) start = 0;
     auto stop = start + fLongGate;
-    if (stop > int(fSignal->size())) stop = fSignal->size();
+    if (stop > int(fSize)) stop = fSize;
 
     for (auto i = start; i < stop; i++) {
-      fLongCharge += fBaseLine - double((*fSignal)[i]);
+      fLongCharge += fBaseLine - double(fSignal[i]);
     }
     // std::cout << "long\t" << fLongCharge << std::endl;
   }
@@ -174,7 +265,7 @@ void TSignal::CalPulseHeight()
 {
   fPulseHeight = 0.;
   if (fTrgTime > 0.) {
-    double min = *std::min_element(fSignal->begin(), fSignal->end());
+    double min = *std::min_element(fSignal, fSignal + fSize);
     fPulseHeight = fBaseLine - min;
   }
 }
@@ -0,0 +1,200 @@
+#include <algorithm>
+#include <climits>
+
+#if defined(__AVX2__) || defined(__AVX512BW__)
+#include <immintrin.h>
+#endif
+
+#include "TSignalKernel.hpp"
+
+#if defined(__AVX512BW__)
+namespace
+{
+// GCC 12 avx512 headers use _mm256_undefined_si256() in the extract
+// functions, and -O2 or more warns about it.  Not our bug.  Only the
+// extracts are excluded from the warnings
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wuninitialized"
+#pragma GCC diagnostic ignored "-Wmaybe-uninitialized"
+#endif
+int32_t ReduceAdd(__m512i v) { return _mm512_reduce_add_epi32(v); }
+
+__m256i MinHalves(__m512i v)
+{
+  return _mm256_min_epi16(_mm512_castsi512_si256(v),
+                          _mm512_extracti64x4_epi64(v, 1));
+}
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic pop
+#endif
+}  // namespace
+#endif
+
+#if defined(__AVX2__)
+namespace
+{
+int32_t HorizontalSum(__m256i v)
+{
+  auto sum = _mm_add_epi32(_mm256_castsi256_si128(v),
+                           _mm256_extracti128_si256(v, 1));
+  sum = _mm_add_epi32(sum, _mm_shuffle_epi32(sum, 0b01001110));
+  sum = _mm_add_epi32(sum, _mm_shuffle_epi32(sum, 0b10110001));
+  return _mm_cvtsi128_si32(sum);
+}
+
+short HorizontalMin(__m256i v)
+{
+  auto min = _mm_min_epi16(_mm256_castsi256_si128(v),
+                           _mm256_extracti128_si256(v, 1));
+  min = _mm_min_epi16(min, _mm_shuffle_epi32(min, 0b01001110));
+  min = _mm_min_epi16(min, _mm_shuffle_epi32(min, 0b10110001));
+  min = _mm_min_epi16(min, _mm_srli_epi32(min, 16));
+  return short(_mm_cvtsi128_si32(min));
+}
+
+short HorizontalMax(__m256i v)
+{
+  auto max = _mm_max_epi16(_mm256_castsi256_si128(v),
+                           _mm256_extracti128_si256(v, 1));
+  max = _mm_max_epi16(max, _mm_shuffle_epi32(max, 0b01001110));
+  max = _mm_max_epi16(max, _mm_shuffle_epi32(max, 0b10110001));
+  max = _mm_max_epi16(max, _mm_srli_epi32(max, 16));
+  return short(_mm_cvtsi128_si32(max));
+}
+}  // namespace
+#endif
+
+int64_t TSignalKernel::Sum(const short *data, int begin, int end)
+{
+  // 16 bits pairs are added into 32 bits lanes by madd.
+  // No overflow for the record length in uint16_t.
+  int64_t sum = 0;
+  auto i = begin;
+
+#if defined(__AVX512BW__)
+  const auto ones512 = _mm512_set1_epi16(1);
+  auto acc512 = _mm512_setzero_si512();
+  for (; i + 32 <= end; i += 32) {
+    auto v = _mm512_loadu_si512((const void *)(data + i));
+    acc512 = _mm512_add_epi32(acc512, _mm512_madd_epi16(v, ones512));
+  }
+  sum += ReduceAdd(acc512);
+#endif
+
+#if defined(__AVX2__)
+  const auto ones256 = _mm256_set1_epi16(1);
+  auto acc256 = _mm256_setzero_si256();
+  for (; i + 16 <= end; i += 16) {
+    auto v = _mm256_loadu_si256((const __m256i *)(data + i));
+    acc256 = _mm256_add_epi32(acc256, _mm256_madd_epi16(v, ones256));
+  }
+  sum += HorizontalSum(acc256);
+#endif
+
+  for (; i < end; i++) sum += data[i];
+
+  return sum;
+}
+
+short TSignalKernel::Min(const short *data, int size)
+{
+  short min = SHRT_MAX;
+  auto i = 0;
+
+#if defined(__AVX512BW__)
+  if (size >= 32) {
+    auto min512 = _mm512_set1_epi16(SHRT_MAX);
+    for (; i + 32 <= size; i += 32)
+      min512 = _mm512_min_epi16(
+          min512, _mm512_loadu_si512((const void *)(data + i)));
+    min = std::min(min, HorizontalMin(MinHalves(min512)));
+  }
+#endif
+
+#if defined(__AVX2__)
+  if (i + 16 <= size) {
+    auto min256 = _mm256_set1_epi16(SHRT_MAX);
+    for (; i + 16 <= size; i += 16)
+      min256 = _mm256_min_epi16(
+          min256, _mm256_loadu_si256((const __m256i *)(data + i)));
+    min = std::min(min, HorizontalMin(min256));
+  }
+#endif
+
+  for (; i < size; i++) min = std::min(min, data[i]);
+
+  return min;
+}
+
+void TSignalKernel::MinMax(const short *data, int size, short &min,
+                           short &max)
+{
+  min = SHRT_MAX;
+  max = SHRT_MIN;
+  auto i = 0;
+
+#if defined(__AVX2__)
+  if (size >= 16) {
+    auto min256 = _mm256_set1_epi16(SHRT_MAX);
+    auto max256 = _mm256_set1_epi16(SHRT_MIN);
+    for (; i + 16 <= size; i += 16) {
+      auto v = _mm256_loadu_si256((const __m256i *)(data + i));
+      min256 = _mm256_min_epi16(min256, v);
+      max256 = _mm256_max_epi16(max256, v);
+    }
+    min = HorizontalMin(min256);
+    max = HorizontalMax(max256);
+  }
+#endif
+
+  for (; i < size; i++) {
+    min = std::min(min, data[i]);
+    max = std::max(max, data[i]);
+  }
+}
+
+int TSignalKernel::FindCrossing(const short *data, int size, int upper,
+                                int lower)
+{
+  if (upper > SHRT_MAX || lower < SHRT_MIN) return -1;  // Never crossing
+  upper = std::max(upper, SHRT_MIN);
+  lower = std::min(lower, int(SHRT_MAX));
+
+  const auto searchSize = size - 1;
+  auto i = 0;
+
+#if defined(__AVX512BW__)
+  const auto upper512 = _mm512_set1_epi16(upper);
+  const auto lower512 = _mm512_set1_epi16(lower);
+  for (; i + 32 <= searchSize; i += 32) {
+    auto v0 = _mm512_loadu_si512((const void *)(data + i));
+    auto v1 = _mm512_loadu_si512((const void *)(data + i + 1));
+    auto hit = _mm512_cmpge_epi16_mask(v0, upper512) &
+               _mm512_cmple_epi16_mask(v1, lower512);
+    if (hit) return i + __builtin_ctz(hit);
+  }
+#endif
+
+#if defined(__AVX2__)
+  // a >= b is a > b - 1.  Only for b > SHRT_MIN
+  if (upper > SHRT_MIN && lower < SHRT_MAX) {
+    const auto upper256 = _mm256_set1_epi16(upper - 1);
+    const auto lower256 = _mm256_set1_epi16(lower + 1);
+    for (; i + 16 <= searchSize; i += 16) {
+      auto v0 = _mm256_loadu_si256((const __m256i *)(data + i));
+      auto v1 = _mm256_loadu_si256((const __m256i *)(data + i + 1));
+      auto hit = _mm256_and_si256(_mm256_cmpgt_epi16(v0, upper256),
+                                  _mm256_cmpgt_epi16(lower256, v1));
+      auto mask = _mm256_movemask_epi8(hit);
+      if (mask) return i + __builtin_ctz(mask) / 2;
+    }
+  }
+#endif
+
+  for (; i < searchSize; i++) {
+    if (data[i] >= upper && data[i + 1] <= lower) return i;
+  }
+
+  return -1;
+}
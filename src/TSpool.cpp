@@ -0,0 +1,258 @@
+#include <fcntl.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <cstring>
+#include <iostream>
+
+#include "TSpool.hpp"
+
+namespace
+{
+constexpr uint64_t kMagic = 0x314C4F4F50535047;  // "GPSPOOL1"
+constexpr uint64_t kHeaderSize = 4096;
+constexpr uint64_t kRecordHeaderSize = 8;  // Size and CRC
+// Rest of the ring is not used, the next record is at the top
+constexpr uint32_t kWrapMark = 0xFFFFFFFF;
+
+uint64_t RecordSize(uint32_t size)
+{
+  return kRecordHeaderSize + ((uint64_t(size) + 7) & ~uint64_t(7));
+}
+
+uint32_t CRC32(const uint8_t *data, uint32_t size)
+{
+  static const struct Table_t {
+    uint32_t val[256];
+    Table_t()
+    {
+      for (uint32_t i = 0; i < 256; i++) {
+        uint32_t c = i;
+        for (auto k = 0; k < 8; k++)
+          c = (c & 1) ? 0xEDB88320 ^ (c >> 1) : c >> 1;
+        val[i] = c;
+      }
+    }
+  } table;
+
+  uint32_t crc = 0xFFFFFFFF;
+  for (uint32_t i = 0; i < size; i++)
+    crc = table.val[(crc ^ data[i]) & 0xFF] ^ (crc >> 8);
+  return crc ^ 0xFFFFFFFF;
+}
+}  // namespace
+
+// Offsets are counted from the start of the run of the file, not wrapped.
+// The position in the ring is offset % capacity.
+struct TSpool::Header_t {
+  uint64_t magic;
+  uint64_t capacity;
+  uint64_t readOffset;
+  uint64_t writeOffset;
+};
+
+TSpool::TSpool(const std::string &fileName, uint64_t size)
+    : fFD(-1), fMap(nullptr), fNRecords(0), fHeader(nullptr), fData(nullptr)
+{
+  fCapacity = (size + 7) & ~uint64_t(7);
+  fMapSize = kHeaderSize + fCapacity;
+
+  if (!fileName.empty()) {
+    fFD = open(fileName.c_str(), O_RDWR | O_CREAT, 0644);
+    // One process for one spool.  Taken before the size check, not to
+    // clear the records of the owner.  Released by close()
+    if (fFD >= 0 && flock(fFD, LOCK_EX | LOCK_NB) != 0) {
+      std::cout << "Spool " << fileName << " is used by another process"
+                << std::endl;
+      close(fFD);
+      fFD = -1;
+    }
+    struct stat st;
+    if (fFD >= 0 && fstat(fFD, &st) == 0 && uint64_t(st.st_size) != fMapSize) {
+      // Other size of the spool.  The old records can not be used
+      if (st.st_size > 0)
+        std::cout << "Spool " << fileName << " has another size, cleared"
+                  << std::endl;
+      if (ftruncate(fFD, 0) != 0 || ftruncate(fFD, fMapSize) != 0) {
+        close(fFD);
+        fFD = -1;
+      }
+    }
+    if (fFD >= 0) {
+      auto map = mmap(nullptr, fMapSize, PROT_READ | PROT_WRITE, MAP_SHARED,
+                      fFD, 0);
+      if (map == MAP_FAILED) {
+        close(fFD);
+        fFD = -1;
+      } else {
+        fMap = static_cast<uint8_t *>(map);
+      }
+    }
+    if (fFD < 0)
+      std::cout << "Spool " << fileName
+                << " can not be opened.  Results are kept only in memory"
+                << std::endl;
+  }
+
+  if (!fMap) {
+    auto map = mmap(nullptr, fMapSize, PROT_READ | PROT_WRITE,
+                    MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (map == MAP_FAILED) {
+      std::cout << "No memory for the spool" << std::endl;
+      fCapacity = 0;
+      return;
+    }
+    fMap = static_cast<uint8_t *>(map);
+  }
+
+  fHeader = reinterpret_cast<Header_t *>(fMap);
+  fData = fMap + kHeaderSize;
+  if (fHeader->magic == kMagic && fHeader->capacity == fCapacity) {
+    Recover();
+  } else {
+    fHeader->magic = kMagic;
+    fHeader->capacity = fCapacity;
+    fHeader->readOffset = fHeader->writeOffset = 0;
+  }
+}
+
+TSpool::~TSpool()
+{
+  if (fMap) {
+    if (fFD >= 0) msync(fMap, fMapSize, MS_SYNC);
+    munmap(fMap, fMapSize);
+  }
+  if (fFD >= 0) close(fFD);
+}
+
+void TSpool::Recover()
+{
+  auto offset = fHeader->readOffset;
+  const auto writeOffset = fHeader->writeOffset;
+  if (writeOffset < offset || writeOffset - offset > fCapacity) {
+    std::cout << "Broken spool offsets, cleared" << std::endl;
+    fHeader->readOffset = fHeader->writeOffset = 0;
+    return;
+  }
+
+  // Records are checked until the last one, or the first broken one
+  while (offset < writeOffset) {
+    const auto pos = offset % fCapacity;
+    uint32_t size, crc;
+    memcpy(&size, fData + pos, sizeof(size));
+    if (size == kWrapMark) {
+      offset += fCapacity - pos;
+      continue;
+    }
+    memcpy(&crc, fData + pos + 4, sizeof(crc));
+    const auto recordSize = RecordSize(size);
+    if (pos + recordSize > fCapacity || offset + recordSize > writeOffset ||
+        CRC32(fData + pos + kRecordHeaderSize, size) != crc)
+      break;
+
+    offset += recordSize;
+    fNRecords++;
+  }
+
+  if (offset != writeOffset) {
+    std::cout << "Spool records after a broken one are discarded"
+              << std::endl;
+    fHeader->writeOffset = offset;
+  }
+  if (fNRecords > 0)
+    std::cout << fNRecords << " records are left in the spool" << std::endl;
+}
+
+uint32_t TSpool::Append(const uint8_t *data, uint32_t size)
+{
+  const auto recordSize = RecordSize(size);
+  if (!fMap || recordSize > fCapacity) return 1;
+
+  auto offset = fHeader->writeOffset;
+  auto pos = offset % fCapacity;
+  const auto tail = fCapacity - pos;
+  const auto needed = (tail < recordSize) ? tail + recordSize : recordSize;
+
+  uint32_t nDropped = 0;
+  while (GetUsedBytes() > 0 && GetUsedBytes() + needed > fCapacity) {
+    if (fNRecords == 0) {
+      fHeader->readOffset = fHeader->writeOffset;  // Only wrap marks
+      break;
+    }
+    DropOldest();
+    nDropped++;
+  }
+
+  if (tail < recordSize) {
+    memcpy(fData + pos, &kWrapMark, sizeof(kWrapMark));
+    offset += tail;
+    pos = 0;
+    // Empty spool, the record can use the whole ring
+    if (GetUsedBytes() == 0) fHeader->readOffset = offset;
+  }
+  const auto crc = CRC32(data, size);
+  memcpy(fData + pos, &size, sizeof(size));
+  memcpy(fData + pos + 4, &crc, sizeof(crc));
+  memcpy(fData + pos + kRecordHeaderSize, data, size);
+
+  // The record is written before it is seen from the header
+  std::atomic_signal_fence(std::memory_order_release);
+  fHeader->writeOffset = offset + recordSize;
+  fNRecords++;
+
+  return nDropped;
+}
+
+void TSpool::DropOldest()
+{
+  auto offset = fHeader->readOffset;
+  const uint8_t *data;
+  uint32_t size;
+  if (Read(offset, data, size)) {
+    fHeader->readOffset = offset;
+    fNRecords--;
+  }
+}
+
+bool TSpool::Read(uint64_t &offset, const uint8_t *&data,
+                  uint32_t &size) const
+{
+  while (fMap && offset < fHeader->writeOffset) {
+    const auto pos = offset % fCapacity;
+    memcpy(&size, fData + pos, sizeof(size));
+    if (size == kWrapMark) {
+      offset += fCapacity - pos;
+      continue;
+    }
+
+    data = fData + pos + kRecordHeaderSize;
+    offset += RecordSize(size);
+    return true;
+  }
+
+  return false;
+}
+
+uint64_t TSpool::GetReadOffset() const
+{
+  return fMap ? fHeader->readOffset : 0;
+}
+
+void TSpool::Commit(uint64_t offset)
+{
+  // The records can be dropped by Append() after they were read
+  auto readOffset = GetReadOffset();
+  const uint8_t *data;
+  uint32_t size;
+  while (readOffset < offset && Read(readOffset, data, size)) fNRecords--;
+  if (fMap && readOffset > fHeader->readOffset)
+    fHeader->readOffset = readOffset;
+}
+
+uint64_t TSpool::GetUsedBytes() const
+{
+  return fMap ? fHeader->writeOffset - fHeader->readOffset : 0;
+}
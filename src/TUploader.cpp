@@ -0,0 +1,144 @@
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <iostream>
+
+#include <mongocxx/uri.hpp>
+
+#include "TUploader.hpp"
+
+namespace
+{
+constexpr uint32_t kMinBackoff = 100;    // ms
+constexpr uint32_t kMaxBackoff = 30000;  // ms
+}  // namespace
+
+TUploader::TUploader(const std::string &uri, const std::string &dbName,
+                     const std::string &collectionName)
+    : fURI(uri),
+      fDBName(dbName),
+      fCollectionName(collectionName),
+      fSpoolName(""),
+      fSpoolSize(256 << 20),
+      fBatchSize(16),
+      fStat{0, 0, 0, 0, 0, 0., 0.},
+      fRunning(false)
+{
+}
+
+TUploader::~TUploader() { Stop(); }
+
+void TUploader::Start()
+{
+  if (fThread.joinable()) return;
+  {
+    std::lock_guard<std::mutex> lock(fMutex);
+    if (!fSpool) fSpool.reset(new TSpool(fSpoolName, fSpoolSize));
+  }
+  fRunning = true;
+  fThread = std::thread(&TUploader::Loop, this);
+}
+
+void TUploader::Stop()
+{
+  {
+    std::lock_guard<std::mutex> lock(fMutex);
+    fRunning = false;
+  }
+  fCond.notify_all();
+  if (fThread.joinable()) fThread.join();
+}
+
+void TUploader::Push(bsoncxx::document::value doc)
+{
+  const auto view = doc.view();
+  {
+    std::lock_guard<std::mutex> lock(fMutex);
+    if (fSpool) {
+      // The newest result is more important for the monitor
+      fStat.nDropped += fSpool->Append(view.data(), view.length());
+    } else {
+      fStat.nDropped++;
+    }
+  }
+  fCond.notify_one();
+}
+
+UploadStat_t TUploader::GetStat()
+{
+  std::lock_guard<std::mutex> lock(fMutex);
+  auto stat = fStat;
+  stat.queueDepth = fSpool ? fSpool->GetNRecords() : 0;
+  stat.spoolBytes = fSpool ? fSpool->GetUsedBytes() : 0;
+  return stat;
+}
+
+void TUploader::Loop()
+{
+  std::vector<bsoncxx::document::value> batch;
+  uint64_t batchEnd = 0;  // Spool offset after the batch
+  auto backoff = kMinBackoff;
+
+  while (true) {
+    if (batch.empty()) {
+      std::unique_lock<std::mutex> lock(fMutex);
+      fCond.wait(lock,
+                 [this] { return fSpool->GetNRecords() > 0 || !fRunning; });
+      if (fSpool->GetNRecords() == 0) break;  // Stopped and nothing left
+
+      // Copied.  The spool can be overwritten during the insert
+      batchEnd = fSpool->GetReadOffset();
+      const uint8_t *data;
+      uint32_t size;
+      while (batch.size() < fBatchSize &&
+             fSpool->Read(batchEnd, data, size)) {
+        auto copy = new uint8_t[size];
+        memcpy(copy, data, size);
+        batch.emplace_back(copy, size, [](uint8_t *p) { delete[] p; });
+      }
+    }
+
+    if (Insert(batch)) {
+      std::lock_guard<std::mutex> lock(fMutex);
+      fSpool->Commit(batchEnd);
+      batch.clear();
+      backoff = kMinBackoff;
+      continue;
+    }
+
+    // The same batch is tried again after the backoff.  When stopped, it
+    // stays in the spool for the next run
+    std::unique_lock<std::mutex> lock(fMutex);
+    if (!fRunning) break;
+    fCond.wait_for(lock, std::chrono::milliseconds(backoff),
+                   [this] { return !fRunning.load(); });
+    backoff = std::min(backoff * 2, kMaxBackoff);
+  }
+}
+
+bool TUploader::Insert(const std::vector<bsoncxx::document::value> &batch)
+{
+  const auto start = std::chrono::steady_clock::now();
+  try {
+    if (!fClient) fClient.reset(new mongocxx::client(mongocxx::uri(fURI)));
+    auto collection = (*fClient)[fDBName][fCollectionName];
+    collection.insert_many(batch);
+  } catch (const std::exception &e) {
+    std::cout << "Upload failed: " << e.what() << std::endl;
+    fClient.reset();  // Connecting again for the next try
+
+    std::lock_guard<std::mutex> lock(fMutex);
+    fStat.nFailures++;
+    return false;
+  }
+  const std::chrono::duration<double, std::milli> latency =
+      std::chrono::steady_clock::now() - start;
+  fInsertLatency.Observe(latency.count() / 1000.);
+
+  std::lock_guard<std::mutex> lock(fMutex);
+  fStat.nUploaded += batch.size();
+  fStat.lastLatency = latency.count();
+  fStat.maxLatency = std::max(fStat.maxLatency, latency.count());
+
+  return true;
+}
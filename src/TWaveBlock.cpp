@@ -0,0 +1,33 @@
+#include <utility>
+
+#include "TWaveBlock.hpp"
+
+TWaveBlock::TWaveBlock() : fNEvents(0), fMaxEvents(0), fRecordLength(0) {}
+
+TWaveBlock::TWaveBlock(uint32_t maxEvents, uint32_t recordLength)
+    : TWaveBlock()
+{
+  Allocate(maxEvents, recordLength);
+}
+
+TWaveBlock::~TWaveBlock() {}
+
+void TWaveBlock::Swap(TWaveBlock &block)
+{
+  std::swap(fNEvents, block.fNEvents);
+  std::swap(fMaxEvents, block.fMaxEvents);
+  std::swap(fRecordLength, block.fRecordLength);
+  for (auto i = 0; i < kNChs; i++) fSamples[i].swap(block.fSamples[i]);
+  fTime.swap(block.fTime);
+}
+
+void TWaveBlock::Allocate(uint32_t maxEvents, uint32_t recordLength)
+{
+  fNEvents = 0;
+  fMaxEvents = maxEvents;
+  fRecordLength = recordLength;
+
+  const auto size = std::size_t(fMaxEvents) * fRecordLength;
+  for (auto &&samples : fSamples) samples.resize(size, 0);
+  fTime.resize(fMaxEvents, 0);
+}
@@ -0,0 +1,167 @@
+#include <unistd.h>
+#include <cmath>
+#include <iostream>
+
+#include "TWaveEmulator.hpp"
+
+TWaveEmulator::TWaveEmulator()
+    : TWaveRecord(),
+      fRate(0.),
+      fPileUpFraction(0.01),
+      fNeutronFraction(0.3),
+      fNoise(5.),
+      fUniform(0., 1.),
+      fBaseLine(0.),
+      fTrgPos(0),
+      fTime(0)
+{
+  // Same as V1730
+  fDigitizerModel = 730;
+  fFirmware = FirmWareCode::STD;
+  fNChs = 16;
+  fTSample = 2;
+  fNBits = 14;
+
+  SetParameters();
+}
+
+TWaveEmulator::~TWaveEmulator() {}
+
+void TWaveEmulator::Initialize()
+{
+  fBlock.Allocate(fBLTEvents, fRecordLength);
+  MakeShapes();
+}
+
+void TWaveEmulator::MakeShapes()
+{
+  // Same baseline for both polarities.  See LoadParameters()
+  fBaseLine = (1 << fNBits) * (1. - fDCOffset / double(0xFFFF));
+  fTrgPos = fRecordLength * (100 - fPostTriggerSize) / 100;
+
+  // Rise time and two decay components in samples
+  auto shape = [](double t, double slowRatio) {
+    constexpr auto rise = 1.5;
+    constexpr auto fast = 4.;
+    constexpr auto slow = 40.;
+    if (t < 0.) return 0.;
+    return (1. - exp(-t / rise)) *
+           ((1. - slowRatio) * exp(-t / fast) + slowRatio * exp(-t / slow));
+  };
+
+  fGammaShape.resize(fRecordLength);
+  fNeutronShape.resize(fRecordLength);
+  auto gammaMax = 0.;
+  auto neutronMax = 0.;
+  for (uint32_t i = 0; i < fRecordLength; i++) {
+    fGammaShape[i] = shape(i, 0.05);
+    fNeutronShape[i] = shape(i, 0.25);
+    gammaMax = std::max(gammaMax, fGammaShape[i]);
+    neutronMax = std::max(neutronMax, fNeutronShape[i]);
+  }
+  for (uint32_t i = 0; i < fRecordLength; i++) {
+    fGammaShape[i] /= gammaMax;
+    fNeutronShape[i] /= neutronMax;
+  }
+
+  constexpr auto noiseSize = 1 << 16;
+  std::normal_distribution<double> gaus(0., fNoise);
+  fNoiseTable.resize(noiseSize + fRecordLength);
+  for (auto &&noise : fNoiseTable) noise = std::round(gaus(fRandom));
+}
+
+CAEN_DGTZ_ErrorCode TWaveEmulator::StartAcquisition()
+{
+  fTime = 0;
+  fLastRead = std::chrono::steady_clock::now();
+  return CAEN_DGTZ_Success;
+}
+
+void TWaveEmulator::StopAcquisition() {}
+
+void TWaveEmulator::ReadEvents()
+{
+  fBlock.Clear();
+  fEveCounter = 0;
+
+  auto nEvents = fBLTEvents;
+  if (fRate > 0.) {
+    // Only the events which should be happened since the last read
+    auto now = std::chrono::steady_clock::now();
+    std::chrono::duration<double> elapsed = now - fLastRead;
+    auto expected = uint32_t(elapsed.count() * fRate);
+    if (expected == 0) {
+      usleep(100);
+      return;
+    }
+    if (expected < nEvents) nEvents = expected;
+    std::chrono::duration<double> generated(nEvents / fRate);
+    fLastRead +=
+        std::chrono::duration_cast<std::chrono::nanoseconds>(generated);
+    // Not to be faster than real time after a long pause
+    if (now - fLastRead > std::chrono::seconds(1)) fLastRead = now;
+  }
+
+  const auto meanInterval = (fRate > 0.) ? 1.e9 / fRate : 1.e3;  // ns
+  for (uint32_t iEve = 0; iEve < nEvents; iEve++) {
+    fTime += uint64_t(-meanInterval * log(1. - fUniform(fRandom)));
+    const auto index = fBlock.AddEvent(fTime);
+    GenerateEvent(index);
+    fEveCounter++;
+  }
+}
+
+void TWaveEmulator::GenerateEvent(uint32_t index)
+{
+  const auto noiseRange = fNoiseTable.size() - fRecordLength;
+  auto fillBase = [&](short *trace) {
+    const auto noise = &fNoiseTable[uint32_t(fUniform(fRandom) * noiseRange)];
+    for (uint32_t i = 0; i < fRecordLength; i++)
+      trace[i] = short(fBaseLine) + noise[i];
+  };
+
+  // Gamma comes at the same time, neutron comes later (in samples)
+  auto isNeutron = fUniform(fRandom) < fNeutronFraction;
+  auto tof = isNeutron ? 20. + 60. * fUniform(fRandom)
+                       : 10. + 0.5 * fUniform(fRandom);
+  auto beamPos = fTrgPos - int(tof);
+  if (beamPos < 1) beamPos = 1;
+
+  // Beam trigger: logic like signal
+  auto beam = fBlock.GetTrace(TWaveBlock::kBeam, index);
+  fillBase(beam);
+  for (uint32_t i = beamPos; i < fRecordLength; i++) beam[i] -= 4000;
+  beam[beamPos] += 2000;
+
+  TWaveBlock::Channel_t planes[3]{TWaveBlock::kIn, TWaveBlock::kOut1,
+                                  TWaveBlock::kOut2};
+  for (auto ch : planes) {
+    auto trace = fBlock.GetTrace(ch, index);
+    fillBase(trace);
+
+    const auto &shape = isNeutron ? fNeutronShape : fGammaShape;
+    const auto amplitude = 500. + 7500. * fUniform(fRandom);
+    AddPulse(trace, shape, fTrgPos, amplitude);
+
+    if (fUniform(fRandom) < fPileUpFraction) {
+      auto pileUpNeutron = fUniform(fRandom) < fNeutronFraction;
+      const auto &pileUpShape = pileUpNeutron ? fNeutronShape : fGammaShape;
+      auto start = fTrgPos + 2 + int((fRecordLength - fTrgPos) *
+                                     fUniform(fRandom));
+      AddPulse(trace, pileUpShape, start, 500. + 7500. * fUniform(fRandom));
+    }
+  }
+}
+
+void TWaveEmulator::AddPulse(short *trace, const std::vector<double> &shape,
+                             int start, double amplitude)
+{
+  const auto sign = (fPolarity == CAEN_DGTZ_TriggerOnFallingEdge) ? -1. : 1.;
+  const int max = (1 << fNBits) - 1;
+  for (int i = start, j = 0; i < int(fRecordLength); i++, j++) {
+    int val = trace[i] + int(sign * amplitude * shape[j]);
+    if (val < 0) val = 0;
+    if (val > max) val = max;
+    trace[i] = val;
+  }
+}
@@ -17,7 +17,14 @@ TWaveRecord::TWaveRecord()
       fPolarity(CAEN_DGTZ_TriggerOnRisingEdge),
       fPostTriggerSize(50),
       fTimeOffset(0),
-      fPreviousTime(0)
+      fPreviousTime(0),
+      fNReadoutBuffers(1),
+      fReadoutFlag(false),
+      fReadBytes(0),
+      fReadCounter(0),
+      fBusyTime(0),
+      fStallTime(0),
+      fStatTime(0)
 {
 }
 
@@ -31,27 +38,39 @@ TWaveRecord::TWaveRecord(CAEN_DGTZ_ConnectionType type, int link, int node,
   SetParameters();
 
   // fDataArray = new unsigned char[fBLTEvents * fOneHitSize * fNChs];
+}
+
+TWaveRecord::~TWaveRecord()
+{
+  if (fReadoutThread.joinable()) {
+    fReadoutFlag = false;
+    fBufferCond.notify_all();
+    fReadoutThread.join();
+  }
 
-  fDataVec.resize(fBLTEvents * 2);
-  for (auto &&data : fDataVec) {
-    data.inPlane.reserve(fRecordLength);
-    data.outPlane1.reserve(fRecordLength);
-    data.outPlane2.reserve(fRecordLength);
-    data.beamTrg.reserve(fRecordLength);
+  if (fHandler >= 0) {  // Software digitizer has no device
+    Reset();
+    Close();
   }
-  fDataVec.resize(0);
+  FreeReadoutBuffers();
+
+  delete[] fDataArray;
 }
 
-TWaveRecord::~TWaveRecord()
+void TWaveRecord::FreeReadoutBuffers()
 {
-  Reset();
-  Close();
   if (fpReadoutBuffer) {
     auto err = CAEN_DGTZ_FreeReadoutBuffer(&fpReadoutBuffer);
     PrintError(err, "FreeReadoutBuffer");
+    fpReadoutBuffer = nullptr;
   }
 
-  delete[] fDataArray;
+  for (auto &&buffer : fReadoutBuffers) {
+    auto err = CAEN_DGTZ_FreeReadoutBuffer(&buffer);
+    PrintError(err, "FreeReadoutBuffer");
+  }
+  fReadoutBuffers.clear();
+  fReadoutSizes.clear();
 }
 
 void TWaveRecord::SetParameters()
@@ -123,39 +142,162 @@ void TWaveRecord::Initialize()
 
   err = CAEN_DGTZ_SetMaxNumEventsBLT(fHandler, fBLTEvents);
   PrintError(err, "SetMaxNEventsBLT");
-  err = CAEN_DGTZ_MallocReadoutBuffer(fHandler, &fpReadoutBuffer,
-                                      &fMaxBufferSize);
-  PrintError(err, "MallocReadoutBuffer");
+
+  FreeReadoutBuffers();
+  if (IsAsyncReadout()) {
+    fReadoutBuffers.resize(fNReadoutBuffers, nullptr);
+    fReadoutSizes.resize(fNReadoutBuffers, 0);
+    for (auto &&buffer : fReadoutBuffers) {
+      err = CAEN_DGTZ_MallocReadoutBuffer(fHandler, &buffer, &fMaxBufferSize);
+      PrintError(err, "MallocReadoutBuffer");
+    }
+  } else {
+    err = CAEN_DGTZ_MallocReadoutBuffer(fHandler, &fpReadoutBuffer,
+                                        &fMaxBufferSize);
+    PrintError(err, "MallocReadoutBuffer");
+  }
+
+  // One block holds one BLT read
+  fBlock.Allocate(fBLTEvents, fRecordLength);
 
   BoardCalibration();
 }
 
 void TWaveRecord::ReadEvents()
 {
-  CAEN_DGTZ_ErrorCode err;
-  err = CAEN_DGTZ_ReadData(fHandler, CAEN_DGTZ_SLAVE_TERMINATED_READOUT_MBLT,
+  if (!IsAsyncReadout()) {
+    auto start = std::chrono::steady_clock::now();
+    auto err =
+        CAEN_DGTZ_ReadData(fHandler, CAEN_DGTZ_SLAVE_TERMINATED_READOUT_MBLT,
                            fpReadoutBuffer, &fBufferSize);
-  PrintError(err, "ReadData");
+    PrintError(err, "ReadData");
+    if (fBufferSize > 0) {
+      auto stop = std::chrono::steady_clock::now();
+      fBusyTime += std::chrono::duration_cast<std::chrono::nanoseconds>(
+                       stop - start)
+                       .count();
+      fReadBytes += fBufferSize;
+      fReadCounter++;
+    }
 
-  uint32_t nEvents;
-  err =
-      CAEN_DGTZ_GetNumEvents(fHandler, fpReadoutBuffer, fBufferSize, &nEvents);
-  PrintError(err, "GetNumEvents");
-  // std::cout << nEvents << " Events" << std::endl;
+    DecodeBuffer(fpReadoutBuffer, fBufferSize);
+    return;
+  }
 
-  // fData->clear();
+  // Take the oldest filled buffer from the readout thread
+  uint32_t index;
+  {
+    std::unique_lock<std::mutex> lock(fBufferMutex);
+    auto filled = fBufferCond.wait_for(
+        lock, std::chrono::milliseconds(100),
+        [this] { return !fFilledBuffers.empty() || !fReadoutFlag; });
+    if (!filled || fFilledBuffers.empty()) {
+      fBlock.Clear();
+      fEveCounter = 0;
+      return;
+    }
+    index = fFilledBuffers.front();
+    fFilledBuffers.pop_front();
+  }
 
-  fDataVec.resize(0);
-  static HitData_t buf;
-  buf.inPlane.resize(fRecordLength, 0);
-  buf.outPlane1.resize(fRecordLength, 0);
-  buf.outPlane2.resize(fRecordLength, 0);
-  buf.beamTrg.resize(fRecordLength, 0);
+  DecodeBuffer(fReadoutBuffers[index], fReadoutSizes[index]);
 
+  {
+    std::lock_guard<std::mutex> lock(fBufferMutex);
+    fFreeBuffers.push_back(index);
+  }
+  fBufferCond.notify_all();
+}
+
+void TWaveRecord::ReadoutLoop()
+{
+  using namespace std::chrono;
+
+  while (fReadoutFlag) {
+    uint32_t index;
+    {
+      // When all buffers are waiting decode, the events stay in the board
+      // memory.  This time is reported as stall.
+      auto start = steady_clock::now();
+      std::unique_lock<std::mutex> lock(fBufferMutex);
+      fBufferCond.wait(lock, [this] {
+        return !fFreeBuffers.empty() || !fReadoutFlag;
+      });
+      if (!fReadoutFlag) break;
+      index = fFreeBuffers.front();
+      fFreeBuffers.pop_front();
+      fStallTime +=
+          duration_cast<nanoseconds>(steady_clock::now() - start).count();
+    }
+
+    auto start = steady_clock::now();
+    uint32_t size = 0;
+    auto err =
+        CAEN_DGTZ_ReadData(fHandler, CAEN_DGTZ_SLAVE_TERMINATED_READOUT_MBLT,
+                           fReadoutBuffers[index], &size);
+    PrintError(err, "ReadData");
+    fReadoutSizes[index] = size;
+
+    if (size > 0) {
+      fBusyTime +=
+          duration_cast<nanoseconds>(steady_clock::now() - start).count();
+      fReadBytes += size;
+      fReadCounter++;
+    }
+
+    {
+      std::lock_guard<std::mutex> lock(fBufferMutex);
+      if (size > 0)
+        fFilledBuffers.push_back(index);
+      else
+        fFreeBuffers.push_front(index);
+    }
+    fBufferCond.notify_all();
+
+    if (size == 0) usleep(100);  // No data in the board
+  }
+}
+
+ReadoutStat_t TWaveRecord::GetReadoutStat()
+{
+  const auto now = std::chrono::steady_clock::now().time_since_epoch().count();
+  const std::chrono::steady_clock::duration interval(now -
+                                                     fStatTime.exchange(now));
+  const double elapsed =
+      std::chrono::duration_cast<std::chrono::nanoseconds>(interval).count();
+
+  ReadoutStat_t stat;
+  stat.nReads = fReadCounter.exchange(0);
+  const double bytes = fReadBytes.exchange(0);
+  const double busy = fBusyTime.exchange(0);
+  const double stall = fStallTime.exchange(0);
+  if (elapsed > 0.) {
+    stat.bandwidth = bytes / elapsed * 1.e3;  // byte/ns -> MB/s
+    stat.utilization = busy / elapsed;
+    stat.stall = stall / elapsed;
+  } else {
+    stat.bandwidth = stat.utilization = stat.stall = 0.;
+  }
+
+  return stat;
+}
+
+void TWaveRecord::DecodeBuffer(char *buffer, uint32_t size)
+{
+  CAEN_DGTZ_ErrorCode err;
+
+  fBlock.Clear();
   fEveCounter = 0;
-  for (uint iEve = 0; iEve < nEvents; iEve++) {
-    err = CAEN_DGTZ_GetEventInfo(fHandler, fpReadoutBuffer, fBufferSize, iEve,
-                                 &fEventInfo, &fpEventPtr);
+  if (size == 0) return;
+
+  uint32_t nEvents;
+  err = CAEN_DGTZ_GetNumEvents(fHandler, buffer, size, &nEvents);
+  PrintError(err, "GetNumEvents");
+  // std::cout << nEvents << " Events" << std::endl;
+
+  for (uint iEve = 0; iEve < nEvents && !fBlock.IsFull(); iEve++) {
+    err = CAEN_DGTZ_GetEventInfo(fHandler, buffer, size, iEve, &fEventInfo,
+                                 &fpEventPtr);
     PrintError(err, "GetEventInfo");
     // std::cout << "Event number:\t" << iEve << '\n'
     //           << "Event size:\t" << fEventInfo.EventSize << '\n'
@@ -178,31 +320,32 @@ void TWaveRecord::ReadEvents()
     }
     fPreviousTime = timeStamp;
 
-    buf.mod = 0;
-    buf.time = timeStamp;
+    const auto index = fBlock.AddEvent(timeStamp);
 
     for (uint iCh = 0; iCh < fNChs; iCh++) {
       uint32_t ch = (0b1 << iCh);
       if ((ch & fChMask) == false) continue;
-      const uint32_t chSize = fpEventStd->ChSize[iCh];
+      uint32_t chSize = fpEventStd->ChSize[iCh];
       if (chSize == 0) continue;
-
-      for (uint32_t i = 0; i < chSize; i++) {
-        if (iCh == fInCh)
-          buf.inPlane[i] = fpEventStd->DataChannel[iCh][i];
-        else if (iCh == fOutCh1)
-          buf.outPlane1[i] = fpEventStd->DataChannel[iCh][i];
-        else if (iCh == fOutCh2)
-          buf.outPlane2[i] = fpEventStd->DataChannel[iCh][i];
-        else if (iCh == fBeamCh)
-          buf.beamTrg[i] = fpEventStd->DataChannel[iCh][i];
-        else
-          break;
-      }
-      // memcpy(&fDataArray[index], fpEventStd->DataChannel[iCh], waveSize);
+      if (chSize > fRecordLength) chSize = fRecordLength;
+
+      // Channel is checked once per waveform, not for each sample.
+      // The ADC values (at most 14 bits) are the same bits in short.
+      short *trace;
+      if (iCh == fInCh)
+        trace = fBlock.GetTrace(TWaveBlock::kIn, index);
+      else if (iCh == fOutCh1)
+        trace = fBlock.GetTrace(TWaveBlock::kOut1, index);
+      else if (iCh == fOutCh2)
+        trace = fBlock.GetTrace(TWaveBlock::kOut2, index);
+      else if (iCh == fBeamCh)
+        trace = fBlock.GetTrace(TWaveBlock::kBeam, index);
+      else
+        continue;
+
+      memcpy(trace, fpEventStd->DataChannel[iCh], chSize * sizeof(short));
     }
     fEveCounter++;
-    fDataVec.push_back(buf);
   }
 }
 
@@ -272,11 +415,33 @@ CAEN_DGTZ_ErrorCode TWaveRecord::StartAcquisition()
   fTimeOffset = 0;
   fPreviousTime = 0;
 
+  fReadBytes = 0;
+  fReadCounter = 0;
+  fBusyTime = 0;
+  fStallTime = 0;
+  fStatTime = std::chrono::steady_clock::now().time_since_epoch().count();
+
+  if (IsAsyncReadout()) {
+    fFreeBuffers.clear();
+    fFilledBuffers.clear();
+    for (uint32_t i = 0; i < fReadoutBuffers.size(); i++)
+      fFreeBuffers.push_back(i);
+
+    fReadoutFlag = true;
+    fReadoutThread = std::thread(&TWaveRecord::ReadoutLoop, this);
+  }
+
   return err;
 }
 
 void TWaveRecord::StopAcquisition()
 {
+  if (fReadoutThread.joinable()) {
+    fReadoutFlag = false;
+    fBufferCond.notify_all();
+    fReadoutThread.join();
+  }
+
   CAEN_DGTZ_ErrorCode err;
   err = CAEN_DGTZ_SWStopAcquisition(fHandler);
   PrintError(err, "StopAcquisition");